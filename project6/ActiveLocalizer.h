@@ -0,0 +1,397 @@
+#ifndef ACTIVE_LOCALIZER_H
+#define ACTIVE_LOCALIZER_H
+#pragma once
+
+#include <algorithm> // std::min
+#include <chrono>
+#include <cmath>     // cos, sin, exp, log, fabs, M_PI
+#include <cstdio>    // printf
+#include <vector>
+#include "Grid.h"
+#include "Robot.h"
+#include "Vector2.h"
+
+const int    LOCALIZER_BEAM_COUNT      = 9;    // beams of the scan model, spread across the laser
+const int    LOCALIZER_HYPOTHESIS_MAX  = 24;   // most likely hypotheses each motion is judged against
+const double LOCALIZER_SCAN_NOISE      = 0.5;  // meters of noise expected in each modelled beam
+const double LOCALIZER_TIME_WEIGHT     = 0.01; // entropy a motion must save per second it takes
+const int    LOCALIZER_FALLBACK_TICKS  = 10;   // ticks of circling that count as one motion when there is nothing to choose from
+
+/**
+ * A motion the active localizer can choose: turn in place, then drive straight
+ */
+struct CandidateMotion
+{
+  double angle,    // radians to turn first, positive turns counter-clockwise
+         distance; // meters to drive afterwards, negative reverses
+
+  CandidateMotion(double angle = 0, double distance = 0) : angle(angle), distance(distance) {}
+};
+
+/**
+ * Localizes the robot by picking whichever motion should tell its hypotheses
+ * apart the most, rather than driving in a circle until they happen to merge.
+ *
+ * For each candidate motion every likely hypothesis is moved through the map,
+ * and the scan the laser would see from where it ends up is modelled by
+ * casting a handful of beams through the occupancy grid. Hypotheses whose
+ * modelled scans differ will be told apart by localization once the motion is
+ * done, while those with the same scans will not. The motion with the lowest
+ * expected entropy over the hypotheses afterwards is carried out, ties going
+ * to the quicker motion, and the whole thing repeats until
+ * Robot::isLocalized().
+ */
+template <class GridType>
+class ActiveLocalizer
+{
+  /**
+   * A hypothesis the localizer is judging motions against
+   */
+  struct Pose
+  {
+    double x, y, yaw,
+           weight; // share of the weight of every hypothesis judged
+  };
+
+  const GridType& grid;
+  std::vector<CandidateMotion> candidates;
+  double velocity,        // m/s to drive at
+         angularVelocity; // rad/s to turn at
+
+  // reused between decisions so choosing a motion does not allocate
+  std::vector<Pose>   poses;     // most likely hypotheses
+  std::vector<double> bearings;  // bearing of each modelled beam
+  std::vector<double> scans;     // modelled ranges, LOCALIZER_BEAM_COUNT per pose
+  std::vector<double> posterior; // weights if a pose turns out to be the truth
+
+  bool   isFree(double x, double y) const;
+  double castRay(double x, double y, double angle, double maxRange) const;
+  bool   movePose(Pose& pose, const CandidateMotion& motion) const;
+  double getExpectedEntropy(const CandidateMotion& motion, double maxRange, bool& isSafe);
+
+public:
+  // constructor
+  ActiveLocalizer(const GridType& grid, double velocity = 0.5, double angularVelocity = 0.5);
+
+  // candidate motions
+  void clearCandidates();
+  void addCandidate(CandidateMotion motion);
+  const CandidateMotion& getCandidate(int index) const;
+
+  // deciding
+  static double getEntropy(const RobotState& state);
+  int chooseMotion(const RobotState& state);
+
+  // localizes the robot
+  bool localize(Robot& robot, int motionLimit = 50);
+};
+
+/**
+ * Creates a localizer with a spread of turns and short drives to choose from
+ *
+ * @param grid            - occupancy grid of the map localization is using. Must outlive the localizer
+ * @param velocity        - velocity to drive at in m/s
+ * @param angularVelocity - angular velocity to turn at in rad/s
+ */
+template <class GridType>
+ActiveLocalizer<GridType>::ActiveLocalizer(const GridType& grid, double velocity, double angularVelocity) :
+  grid(grid),
+  velocity(velocity),
+  angularVelocity(angularVelocity)
+{
+  addCandidate(CandidateMotion( M_PI / 2.0, 0));
+  addCandidate(CandidateMotion(-M_PI / 2.0, 0));
+  addCandidate(CandidateMotion( M_PI,       0));
+  addCandidate(CandidateMotion( 0,          1.0));
+  addCandidate(CandidateMotion( 0,         -1.0));
+  addCandidate(CandidateMotion( M_PI / 4.0, 1.0));
+  addCandidate(CandidateMotion(-M_PI / 4.0, 1.0));
+  addCandidate(CandidateMotion( M_PI / 2.0, 1.0));
+  addCandidate(CandidateMotion(-M_PI / 2.0, 1.0));
+}
+
+/** Removes every candidate motion, e.g. to replace the defaults */
+template <class GridType>
+void ActiveLocalizer<GridType>::clearCandidates()
+{
+  candidates.clear();
+}
+
+/** @param motion - another motion the localizer may choose */
+template <class GridType>
+void ActiveLocalizer<GridType>::addCandidate(CandidateMotion motion)
+{
+  candidates.push_back(motion);
+}
+
+/**
+ * @param index - index of the candidate, as given by chooseMotion()
+ * @return the candidate motion
+ */
+template <class GridType>
+const CandidateMotion& ActiveLocalizer<GridType>::getCandidate(int index) const
+{
+  return candidates[index];
+}
+
+/**
+ * @param x - x coordinate in meters
+ * @param y - y coordinate in meters
+ * @return true if the point is on the map and not in an occupied cell
+ */
+template <class GridType>
+bool ActiveLocalizer<GridType>::isFree(double x, double y) const
+{
+  int index = grid.worldToIndex(Vector2(x, y));
+  return index >= 0 && !grid.isOccupied(index);
+}
+
+/**
+ * Walks a beam through the grid until it hits something
+ *
+ * @param x        - x coordinate the beam starts from in meters
+ * @param y        - y coordinate the beam starts from in meters
+ * @param angle    - direction of the beam in radians
+ * @param maxRange - furthest the beam can see in meters
+ * @return distance to the first occupied cell, or maxRange if there is none
+ */
+template <class GridType>
+double ActiveLocalizer<GridType>::castRay(double x, double y, double angle, double maxRange) const
+{
+  double step = grid.getCellSize() / 4.0,
+         dx   = cos(angle) * step,
+         dy   = sin(angle) * step;
+
+  for (double range = 0; range < maxRange; range += step)
+  {
+    if (!isFree(x, y)) return range;
+    x += dx;
+    y += dy;
+  }
+
+  return maxRange;
+}
+
+/**
+ * Moves a hypothesis through the candidate motion, stopping it short at
+ * anything in the way the same as the bumper would
+ *
+ * @param pose   - the hypothesis to move
+ * @param motion - the motion to move it by
+ * @return false if something was in the way
+ */
+template <class GridType>
+bool ActiveLocalizer<GridType>::movePose(Pose& pose, const CandidateMotion& motion) const
+{
+  pose.yaw += motion.angle;
+
+  double step  = grid.getCellSize() / 4.0,
+         dx    = cos(pose.yaw) * step * (motion.distance < 0 ? -1 : 1),
+         dy    = sin(pose.yaw) * step * (motion.distance < 0 ? -1 : 1);
+
+  for (double moved = step; moved <= fabs(motion.distance); moved += step)
+  {
+    if (!isFree(pose.x + dx, pose.y + dy)) return false;
+    pose.x += dx;
+    pose.y += dy;
+  }
+
+  return true;
+}
+
+/**
+ * Works out how unsure localization is expected to be after the motion
+ *
+ * @param motion   - the motion to judge
+ * @param maxRange - furthest the laser can see in meters
+ * @param isSafe   - set to false if the most likely hypothesis drives into something
+ * @return expected entropy over the hypotheses once the motion is done
+ */
+template <class GridType>
+double ActiveLocalizer<GridType>::getExpectedEntropy(const CandidateMotion& motion, double maxRange, bool& isSafe)
+{
+  const int count = poses.size();
+
+  // model the scan from where each hypothesis ends up
+  for (int i = 0; i < count; i++)
+  {
+    Pose moved = poses[i];
+    bool isClear = movePose(moved, motion);
+    if (i == 0) isSafe = isClear;
+
+    for (int b = 0; b < LOCALIZER_BEAM_COUNT; b++)
+    {
+      scans[i * LOCALIZER_BEAM_COUNT + b] = castRay(moved.x, moved.y, moved.yaw + bearings[b], maxRange);
+    }
+  }
+
+  // if hypothesis i is the truth, every other hypothesis keeps weight as far as its scan looks the same
+  double expected = 0;
+  for (int i = 0; i < count; i++)
+  {
+    double total = 0;
+    for (int j = 0; j < count; j++)
+    {
+      double difference = 0;
+      for (int b = 0; b < LOCALIZER_BEAM_COUNT; b++)
+      {
+        double d = scans[i * LOCALIZER_BEAM_COUNT + b] - scans[j * LOCALIZER_BEAM_COUNT + b];
+        difference += d * d;
+      }
+
+      posterior[j] = poses[j].weight * exp(-difference / (2.0 * LOCALIZER_SCAN_NOISE * LOCALIZER_SCAN_NOISE));
+      total       += posterior[j];
+    }
+
+    double entropy = 0;
+    for (int j = 0; j < count; j++)
+    {
+      double p = posterior[j] / total;
+      if (p > 0) entropy -= p * log(p);
+    }
+
+    expected += poses[i].weight * entropy;
+  }
+
+  return expected;
+}
+
+/**
+ * @param state - snapshot to judge
+ * @return entropy of the weights of every hypothesis. 0 once there is only one
+ */
+template <class GridType>
+double ActiveLocalizer<GridType>::getEntropy(const RobotState& state)
+{
+  if (state.hypothesisWeight <= 0) return 0;
+
+  double entropy = 0;
+  for (int i = 0; i < (int)state.hypotheses.size(); i++)
+  {
+    double p = state.hypotheses[i].alpha / state.hypothesisWeight;
+    if (p > 0) entropy -= p * log(p);
+  }
+
+  return entropy;
+}
+
+/**
+ * Picks the candidate motion expected to leave localization the least unsure
+ *
+ * @param state - snapshot to decide from
+ * @return index of the chosen candidate, or -1 if the robot has no laser,
+ *         localization has no hypotheses or every candidate is blocked
+ */
+template <class GridType>
+int ActiveLocalizer<GridType>::chooseMotion(const RobotState& state)
+{
+  if (state.laserBearings.empty() || state.hypotheses.empty()) return -1;
+
+  // spread the modelled beams evenly across the laser
+  bearings.resize(LOCALIZER_BEAM_COUNT);
+  for (int b = 0; b < LOCALIZER_BEAM_COUNT; b++)
+  {
+    bearings[b] = state.laserBearings[b * (state.laserBearings.size() - 1) / (LOCALIZER_BEAM_COUNT - 1)];
+  }
+
+  // the most likely hypotheses, with their weights shared out between just them
+  int count = std::min((int)state.hypotheses.size(), LOCALIZER_HYPOTHESIS_MAX);
+  double total = 0;
+  poses.resize(count);
+  for (int i = 0; i < count; i++)
+  {
+    const player_localize_hypoth_t& hypothesis = state.hypotheses[i];
+    poses[i].x      = hypothesis.mean.px;
+    poses[i].y      = hypothesis.mean.py;
+    poses[i].yaw    = hypothesis.mean.pa;
+    poses[i].weight = hypothesis.alpha;
+    total          += hypothesis.alpha;
+  }
+  for (int i = 0; i < count; i++) poses[i].weight = total > 0 ? poses[i].weight / total : 1.0 / count;
+
+  scans.resize(count * LOCALIZER_BEAM_COUNT);
+  posterior.resize(count);
+
+  int    best      = -1;
+  double bestScore = 0;
+  for (int c = 0; c < (int)candidates.size(); c++)
+  {
+    const CandidateMotion& motion = candidates[c];
+    bool   isSafe;
+    double score = getExpectedEntropy(motion, state.laserMaxRange, isSafe) +
+                   LOCALIZER_TIME_WEIGHT * (fabs(motion.angle) / angularVelocity + fabs(motion.distance) / velocity);
+
+    if (isSafe && (best == -1 || score < bestScore))
+    {
+      best      = c;
+      bestScore = score;
+    }
+  }
+
+  return best;
+}
+
+/**
+ * Carries out the most informative motion over and over until localization
+ * settles on one hypothesis, then reports how long that took. Falls back to
+ * driving backwards in a circle like Robot::localize() while there is nothing
+ * to choose from, each LOCALIZER_FALLBACK_TICKS ticks of it counting as a
+ * motion. Stops on Robot::isLocalized(), the same as Robot::localize(), so
+ * the times the two report can be compared.
+ *
+ * @param robot       - the robot to localize
+ * @param motionLimit - the most motions to try before giving up
+ * @return true if the robot is localized
+ */
+template <class GridType>
+bool ActiveLocalizer<GridType>::localize(Robot& robot, int motionLimit)
+{
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  robot.read();
+  double startEntropy = getEntropy(robot.getState());
+  int    motions      = 0;
+
+  while (!robot.isLocalized() && motions < motionLimit && !robot.isMotionCancelled())
+  {
+    const RobotState& state = robot.getState();
+    int choice = chooseMotion(state);
+
+    // nothing to judge motions by, travel backwards in a circle shape for a while
+    if (choice < 0)
+    {
+      for (int i = 0; i < LOCALIZER_FALLBACK_TICKS && !robot.isLocalized() && !robot.isMotionCancelled(); i++)
+      {
+        robot.setSpeed(-0.75, 1.0);
+        robot.read();
+      }
+      motions++;
+      continue;
+    }
+
+    const CandidateMotion& motion = candidates[choice];
+    printf("%d hypotheses, entropy %.2f: turning %.0f degrees then driving %.2fm\n",
+           (int)state.hypotheses.size(), getEntropy(state), motion.angle * 180.0 / M_PI, motion.distance);
+
+    if (motion.angle    != 0) robot.rotateByRadians(motion.angle, angularVelocity);
+    if (motion.distance != 0) robot.moveForwardByMeters(motion.distance, velocity);
+    motions++;
+
+    // back away from anything the map did not know about
+    robot.read();
+    if (robot.isAnyPressed()) robot.dislodgeFromObstacle(0.3, velocity);
+  }
+
+  robot.setSpeed(0, 0, TurnDirection::None);
+
+  std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+  bool isLocalized = robot.isLocalized();
+
+  printf("%s in %.1fs after %d motions, entropy %.2f -> %.2f\n",
+         isLocalized ? "Localized" : "Gave up localizing",
+         elapsed.count(), motions, startEntropy, getEntropy(robot.getState()));
+
+  return isLocalized;
+}
+
+#endif
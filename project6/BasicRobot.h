@@ -0,0 +1,368 @@
+#ifndef BASIC_ROBOT_H
+#define BASIC_ROBOT_H
+#pragma once
+
+#include <cmath>
+#include <cstdlib> // rand
+#include "Robot.h"
+#include "Vector2.h"
+
+/**
+ * Pose policy that trusts the most likely localize hypothesis, like
+ * PositionMethod::Localization. Falls back to the odometer until localization
+ * has a hypothesis, the same as Robot::getLocalizedPos()
+ */
+struct LocalizedPose
+{
+  static Vector2 getPos(const RobotState& state)
+  {
+    if (state.hypotheses.empty()) return state.odometerPos;
+    return Vector2(state.hypotheses[0].mean.px, state.hypotheses[0].mean.py);
+  }
+
+  static double getYaw(const RobotState& state)
+  {
+    return state.hypotheses.empty() ? state.odometerYaw : state.hypotheses[0].mean.pa;
+  }
+};
+
+/**
+ * Pose policy that trusts the odometer, like PositionMethod::Odometry
+ */
+struct OdometerPose
+{
+  static Vector2 getPos(const RobotState& state) { return state.odometerPos; }
+  static double  getYaw(const RobotState& state) { return state.odometerYaw; }
+};
+
+/**
+ * Pose policy that trusts the robot's pose filter, like PositionMethod::Fused
+ */
+struct FusedPose
+{
+  static Vector2 getPos(const RobotState& state) { return state.fusedPos; }
+  static double  getYaw(const RobotState& state) { return state.fusedYaw; }
+};
+
+/**
+ * Bumper policy that leaves bumps to whatever the robot was doing
+ */
+struct IgnoreBumpers
+{
+  bool getCommand(const RobotState& state, double& forwardVelocity, double& angularVelocity)
+  {
+    return false;
+  }
+};
+
+/**
+ * Bumper policy that takes over for a few ticks once a bumper is pressed,
+ * backing up and then turning away from the side that was hit, like
+ * SimpleBumper but without blocking.
+ */
+struct BackOffBumpers
+{
+  int    reverseTicks,    // ticks to back up for
+         turnTicks;       // ticks to turn for after backing up
+  double velocity,        // m/s to back up at
+         angularVelocity; // rad/s to turn at
+  int    ticksLeft;       // ticks until the robot is back in control
+  double turn;            // signed angular velocity of the current turn
+
+  BackOffBumpers(int    reverseTicks    = 10,
+                 int    turnTicks       = 10,
+                 double velocity        = 0.5,
+                 double angularVelocity = 1.0) :
+    reverseTicks(reverseTicks),
+    turnTicks(turnTicks),
+    velocity(velocity),
+    angularVelocity(angularVelocity),
+    ticksLeft(0),
+    turn(0) {}
+
+  bool getCommand(const RobotState& state, double& forwardVelocity, double& angularVelocity);
+};
+
+/**
+ * Laser policy for a robot with a laser
+ */
+struct WithLaser
+{
+  static bool hasLaser() { return true; }
+
+  static double getMinLeft(const RobotState& state)  { return state.laserMinLeft; }
+  static double getMinRight(const RobotState& state) { return state.laserMinRight; }
+};
+
+/**
+ * Laser policy for a robot without one. Every check against the laser is
+ * compiled out.
+ */
+struct WithoutLaser
+{
+  static bool hasLaser() { return false; }
+
+  static double getMinLeft(const RobotState& state)  { return INFINITY; }
+  static double getMinRight(const RobotState& state) { return INFINITY; }
+};
+
+/**
+ * Per-tick controller that drives a Robot from its snapshot, with the pose
+ * source, bumper reaction and laser picked by policies. With the policies
+ * above all three are fixed at compile time and inlined into the caller's
+ * loop.
+ *
+ * This is a controller of its own rather than a faster Robot. Robot still
+ * owns the connection and takes the snapshot, and Robot's own moves still
+ * pick the pose by posMethod and hand bumps to a BumperEventState at run
+ * time. The control laws here are simpler than Robot's as well:
+ * moveToWaypoint() turns while it drives instead of rotating and then
+ * following a motion profile.
+ *
+ *   Robot robot(true, 1.0, 1.0, PositionMethod::Odometry);
+ *   LaserRobot fast(robot);
+ *   fast.moveToWaypoint(Vector2(6, 4));
+ *
+ * The command methods work off of the last read and never read themselves.
+ */
+template <class PosePolicy, class BumperPolicy, class LaserPolicy>
+class BasicRobot
+{
+  Robot&       robot;
+  PosePolicy   pose;
+  BumperPolicy bumper;
+  LaserPolicy  laser;
+
+  void sendCommand(double forwardVelocity, double angularVelocity);
+
+public:
+  // constructor
+  BasicRobot(Robot&       robot,
+             BumperPolicy bumper = BumperPolicy(),
+             PosePolicy   pose   = PosePolicy(),
+             LaserPolicy  laser  = LaserPolicy()) :
+    robot(robot),
+    pose(pose),
+    bumper(bumper),
+    laser(laser) {}
+
+  // read from the environment
+  void read() { robot.read(); }
+  const RobotState& getState() const { return robot.getState(); }
+  Robot& getRobot() { return robot; }
+
+  // pose as of the last read
+  Vector2 getPos() const { return pose.getPos(robot.getState()); }
+  double  getYaw() const { return pose.getYaw(robot.getState()); }
+
+  // commands for a single tick
+  bool getWaypointCommand(Vector2 wp,
+                          double velocity,
+                          double angularVelocity,
+                          double errorRange,
+                          double& forwardCommand,
+                          double& angularCommand);
+  bool getAutoPilotCommand(double velocity,
+                           double angularVelocity,
+                           double& forwardCommand,
+                           double& angularCommand);
+
+  // handle waypoint movement
+  bool moveToWaypoint(Vector2 wp,
+                      double velocity        = 0.5,
+                      double angularVelocity = 0.5,
+                      double errorRange      = 0.25,
+                      int    tickDuration    = INT_MAX);
+
+  // auto-pilot movement
+  void autoPilotLaser(int tickDuration = INT_MAX, double forwardVelocity = 0.5, double angularVelocity = 1.0);
+};
+
+// the combinations the programs use
+typedef BasicRobot<LocalizedPose, BackOffBumpers, WithLaser>    LaserRobot;
+typedef BasicRobot<OdometerPose,  BackOffBumpers, WithoutLaser> BlindRobot;
+
+/**
+ * Takes over from the robot while it backs away from a bump
+ *
+ * @param state           - the snapshot of this tick
+ * @param forwardVelocity - set to the forward velocity to use in m/s when taking over
+ * @param angularVelocity - set to the angular velocity to use in rad/s when taking over
+ * @return true if the bumper policy is driving this tick
+ */
+inline bool BackOffBumpers::getCommand(const RobotState& state, double& forwardVelocity, double& angularVelocity)
+{
+  // turn away from the bumper that was hit, or a random way if both were
+  if (ticksLeft == 0 && state.isAnyPressed)
+  {
+    ticksLeft = reverseTicks + turnTicks;
+    turn      = state.isLeftPressed && state.isRightPressed ? (rand() % 2 ? 1 : -1) * this->angularVelocity :
+                state.isLeftPressed                        ? -this->angularVelocity : this->angularVelocity;
+  }
+
+  if (ticksLeft == 0) return false;
+
+  bool isReversing = ticksLeft > turnTicks;
+  forwardVelocity  = isReversing ? -velocity : 0;
+  angularVelocity  = isReversing ? 0 : turn;
+  ticksLeft--;
+
+  return true;
+}
+
+/**
+ * Sends a signed angular velocity through Robot::setSpeed()
+ *
+ * @param forwardVelocity - m/s
+ * @param angularVelocity - rad/s, positive turns left
+ */
+template <class PosePolicy, class BumperPolicy, class LaserPolicy>
+inline void BasicRobot<PosePolicy, BumperPolicy, LaserPolicy>::sendCommand(double forwardVelocity, double angularVelocity)
+{
+  robot.setSpeed(forwardVelocity, fabs(angularVelocity), angularVelocity < 0 ? TurnDirection::Right : TurnDirection::Left);
+}
+
+/**
+ * Works out the command that takes the robot a tick closer to the waypoint.
+ * The robot turns in place until it faces the waypoint, then drives to it
+ * while steering to keep facing it.
+ *
+ * @param wp              - the waypoint for the robot to move to
+ * @param velocity        - velocity for the robot to move in m/s
+ * @param angularVelocity - angular velocity for the robot to rotate in rad/s
+ * @param errorRange      - minimum distance robot must be from waypoint in meters
+ * @param forwardCommand  - set to the forward velocity to send in m/s
+ * @param angularCommand  - set to the angular velocity to send in rad/s
+ * @return false once the robot has reached the waypoint
+ */
+template <class PosePolicy, class BumperPolicy, class LaserPolicy>
+inline bool BasicRobot<PosePolicy, BumperPolicy, LaserPolicy>::getWaypointCommand(Vector2 wp,
+                                                                                   double velocity,
+                                                                                   double angularVelocity,
+                                                                                   double errorRange,
+                                                                                   double& forwardCommand,
+                                                                                   double& angularCommand)
+{
+  const RobotState& state = robot.getState();
+
+  if (bumper.getCommand(state, forwardCommand, angularCommand)) return true;
+
+  Vector2 pos      = pose.getPos(state);
+  double  dx       = wp.x - pos.x,
+          dy       = wp.y - pos.y,
+          distance = sqrt(dx * dx + dy * dy);
+
+  if (distance < errorRange)
+  {
+    forwardCommand = angularCommand = 0;
+    return false;
+  }
+
+  // same as Robot::clampYawToPi(), which cannot be inlined from here
+  double angle = fmod(atan2(dy, dx) - pose.getYaw(state) + M_PI, 2.0 * M_PI);
+  angle += angle < 0 ? M_PI : -M_PI;
+
+  // face the waypoint before driving to it, slowing down over the last meter
+  double turn    = fmin(angularVelocity, 2.0 * fabs(angle));
+  angularCommand = angle < 0 ? -turn : turn;
+  forwardCommand = fabs(angle) > 0.1 ? 0 : fmin(velocity, distance);
+
+  return true;
+}
+
+/**
+ * Works out the auto-pilot command for a tick, steering away from whichever
+ * side of the laser is closer. Without a laser the robot drives straight.
+ *
+ * @param velocity        - velocity that the robot moves forward at in m/s
+ * @param angularVelocity - angular velocity that the robot rotates at in rad/s
+ * @param forwardCommand  - set to the forward velocity to send in m/s
+ * @param angularCommand  - set to the angular velocity to send in rad/s
+ * @return false if the robot has reached a dead end
+ */
+template <class PosePolicy, class BumperPolicy, class LaserPolicy>
+inline bool BasicRobot<PosePolicy, BumperPolicy, LaserPolicy>::getAutoPilotCommand(double velocity,
+                                                                                    double angularVelocity,
+                                                                                    double& forwardCommand,
+                                                                                    double& angularCommand)
+{
+  const RobotState& state = robot.getState();
+
+  if (bumper.getCommand(state, forwardCommand, angularCommand)) return true;
+
+  forwardCommand = velocity;
+  angularCommand = 0;
+  if (!laser.hasLaser()) return true;
+
+  double minLeft  = laser.getMinLeft(state),
+         minRight = laser.getMinRight(state);
+
+  // reached a dead end, stop moving
+  if (minLeft < 0.30 && minRight < 0.30)
+  {
+    forwardCommand = 0;
+    return false;
+  }
+
+  angularCommand = minRight < minLeft ? angularVelocity : -angularVelocity;
+  return true;
+}
+
+/**
+ * The robot moves to the waypoint, backing off from anything it bumps into
+ * the way its bumper policy says to
+ *
+ * @param wp              - the waypoint for the robot to move to
+ * @param velocity        - velocity for the robot to move in m/s
+ * @param angularVelocity - angular velocity for the robot to rotate in rad/s
+ * @param errorRange      - minimum distance robot must be from waypoint in meters
+ * @param tickDuration    - the most ticks to move for
+ * @return true if the robot reached the waypoint
+ */
+template <class PosePolicy, class BumperPolicy, class LaserPolicy>
+bool BasicRobot<PosePolicy, BumperPolicy, LaserPolicy>::moveToWaypoint(Vector2 wp,
+                                                                       double velocity,
+                                                                       double angularVelocity,
+                                                                       double errorRange,
+                                                                       int    tickDuration)
+{
+  double forward, angular;
+  bool   isMoving = true;
+
+  for (int i = 0; i < tickDuration && isMoving && !robot.isMotionCancelled(); i++)
+  {
+    read();
+    isMoving = getWaypointCommand(wp, velocity, angularVelocity, errorRange, forward, angular);
+    sendCommand(forward, angular);
+  }
+
+  sendCommand(0, 0);
+  return !isMoving;
+}
+
+/**
+ * The robot moves forward, turning away from anything the laser sees, until
+ * it reaches a dead end or runs out of ticks
+ *
+ * @param tickDuration    - the number of ticks to apply auto pilot for
+ * @param forwardVelocity - velocity that the robot moves forward at in m/s
+ * @param angularVelocity - angular velocity that the robot rotates at in rad/s
+ */
+template <class PosePolicy, class BumperPolicy, class LaserPolicy>
+void BasicRobot<PosePolicy, BumperPolicy, LaserPolicy>::autoPilotLaser(int tickDuration,
+                                                                       double forwardVelocity,
+                                                                       double angularVelocity)
+{
+  double forward, angular;
+
+  for (int i = 0; i < tickDuration && !robot.isMotionCancelled(); i++)
+  {
+    read();
+    if (!getAutoPilotCommand(forwardVelocity, angularVelocity, forward, angular)) break;
+    sendCommand(forward, angular);
+  }
+
+  sendCommand(0, 0);
+}
+
+#endif
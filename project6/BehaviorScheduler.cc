@@ -0,0 +1,220 @@
+#include "BehaviorScheduler.h"
+#include <cstdio>  // printf
+#include <time.h>  // clock_gettime, CLOCK_THREAD_CPUTIME_ID
+#include <utility> // std::move
+
+/** @return CPU time used by the calling thread in seconds */
+static double getThreadCpuTime()
+{
+  timespec now;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/**
+ * Takes ownership of a coroutine's frame. Only called by promise_type
+ *
+ * @param handle - the coroutine, suspended before its first line
+ */
+Behavior::Behavior(std::coroutine_handle<promise_type> handle) :
+  handle(handle),
+  cpuTime(0),
+  resumeCount(0) {}
+
+/** Takes the coroutine over from another behavior, leaving it empty */
+Behavior::Behavior(Behavior&& other) noexcept :
+  handle(other.handle),
+  name(std::move(other.name)),
+  cpuTime(other.cpuTime),
+  resumeCount(other.resumeCount)
+{
+  other.handle = std::coroutine_handle<promise_type>();
+}
+
+/** Destroys this behavior's coroutine and takes over another behavior's, leaving it empty */
+Behavior& Behavior::operator=(Behavior&& other) noexcept
+{
+  if (this == &other) return *this;
+
+  if (handle) handle.destroy();
+
+  handle       = other.handle;
+  name         = std::move(other.name);
+  cpuTime      = other.cpuTime;
+  resumeCount  = other.resumeCount;
+  other.handle = std::coroutine_handle<promise_type>();
+  return *this;
+}
+
+/** Destroys the coroutine's frame, along with any locals it still holds */
+Behavior::~Behavior()
+{
+  if (handle) handle.destroy();
+}
+
+/**
+ * Runs the behavior until it yields or finishes
+ *
+ * @return true if the behavior is still running and wants the next tick
+ */
+bool Behavior::resume()
+{
+  if (isDone()) return false;
+
+  double start = getThreadCpuTime();
+  handle.resume();
+  cpuTime += getThreadCpuTime() - start;
+  resumeCount++;
+
+  return !handle.done();
+}
+
+/** @return true once the behavior has finished, or if it holds no coroutine */
+bool Behavior::isDone() const
+{
+  return !handle || handle.done();
+}
+
+/** @param name - name to print the behavior's statistics under */
+void Behavior::setName(const std::string& name)
+{
+  this->name = name;
+}
+
+/** @return name the behavior's statistics are printed under */
+const std::string& Behavior::getName() const
+{
+  return name;
+}
+
+/** @return thread CPU time spent in the behavior in seconds, including any behaviors it runs */
+double Behavior::getCpuTime() const
+{
+  return cpuTime;
+}
+
+/** @return number of ticks the behavior has run for */
+unsigned long Behavior::getResumeCount() const
+{
+  return resumeCount;
+}
+
+/**
+ * Creates a scheduler with nothing to run
+ *
+ * @param robot - the robot every behavior controls
+ */
+BehaviorScheduler::BehaviorScheduler(Robot& robot) :
+  robot(robot) {}
+
+/**
+ * Adds a behavior to run from the next tick on
+ *
+ * @param behavior - the behavior, e.g. localizeBehavior(robot)
+ * @param name     - name to print its statistics under
+ */
+void BehaviorScheduler::add(Behavior behavior, const std::string& name)
+{
+  behavior.setName(name);
+  behaviors.push_back(std::move(behavior));
+}
+
+/** @return number of behaviors that have not finished */
+int BehaviorScheduler::getRunningCount() const
+{
+  int count = 0;
+  for (int i = 0; i < (int)behaviors.size(); i++) count += !behaviors[i].isDone();
+  return count;
+}
+
+/**
+ * Runs a single tick: reads once, then resumes every running behavior
+ *
+ * @return true if any behavior is still running
+ */
+bool BehaviorScheduler::step()
+{
+  if (getRunningCount() == 0) return false;
+
+  robot.read();
+
+  // behaviors added by a behavior during the tick wait for the next one
+  int count = behaviors.size();
+  for (int i = 0; i < count; i++) behaviors[i].resume();
+
+  return getRunningCount() > 0;
+}
+
+/**
+ * Runs ticks until every behavior has finished
+ *
+ * @param tickLimit - the most ticks to run for
+ */
+void BehaviorScheduler::run(int tickLimit)
+{
+  for (int i = 0; i < tickLimit && step(); i++);
+}
+
+/** Prints how much CPU time each behavior has used */
+void BehaviorScheduler::printStats() const
+{
+  printf("\n%-20s %10s %12s %12s\n", "behavior", "ticks", "cpu (ms)", "per tick (us)");
+
+  for (int i = 0; i < (int)behaviors.size(); i++)
+  {
+    const Behavior& behavior = behaviors[i];
+    printf("%-20s %10lu %12.3f %12.1f%s\n",
+           behavior.getName().c_str(),
+           behavior.getResumeCount(),
+           behavior.getCpuTime() * 1e3,
+           behavior.getResumeCount() ? behavior.getCpuTime() * 1e6 / behavior.getResumeCount() : 0.0,
+           behavior.isDone() ? "" : " (running)");
+  }
+}
+
+/**
+ * Robot::localize() as a behavior. The robot drives backwards in a circle
+ * until it is localized.
+ *
+ * @param robot - the robot to localize
+ */
+Behavior localizeBehavior(Robot& robot)
+{
+  while (!robot.isLocalized())
+  {
+    robot.printAllHypotheses();
+
+    // travel backwards in a circle shape
+    robot.setSpeed(-0.75, 1.0);
+    co_yield NextTick();
+  }
+
+  robot.setSpeed(0, 0, TurnDirection::None);
+}
+
+/**
+ * Robot::autoPilotLaser() as a behavior. The robot moves forward, turning
+ * away from whichever side its laser sees something closer on, until it
+ * reaches a dead end or runs out of ticks.
+ *
+ * @param robot           - the robot to drive
+ * @param tickDuration    - the number of ticks to apply auto pilot for
+ * @param forwardVelocity - velocity that the robot moves forward at in m/s
+ * @param angularVelocity - angular velocity that the robot rotates at in rad/s
+ */
+Behavior autoPilotBehavior(Robot& robot, int tickDuration, double forwardVelocity, double angularVelocity)
+{
+  for (int i = 0; i < tickDuration; i++)
+  {
+    const RobotState& state = robot.getState();
+
+    // reached a dead end, stop moving
+    if (state.laserMinLeft < 0.30 && state.laserMinRight < 0.30) break;
+
+    TurnDirection::Enum dir = state.laserMinRight < state.laserMinLeft ? TurnDirection::Left : TurnDirection::Right;
+    robot.setSpeed(forwardVelocity, angularVelocity, dir);
+    co_yield NextTick();
+  }
+
+  robot.setSpeed(0, 0, TurnDirection::None);
+}
@@ -0,0 +1,102 @@
+#ifndef BEHAVIOR_SCHEDULER_H
+#define BEHAVIOR_SCHEDULER_H
+#pragma once
+
+#include <climits>   // INT_MAX
+#include <coroutine>
+#include <deque>
+#include <exception> // std::terminate
+#include <string>
+#include "Robot.h"
+
+/**
+ * Yielded by a behavior to give up the rest of the tick: co_yield NextTick();
+ */
+struct NextTick {};
+
+/**
+ * A behavior written as a C++20 coroutine that yields once per tick. The
+ * coroutine's frame holds its locals between ticks, so there is no stack per
+ * behavior and any number of them can take turns on one thread.
+ *
+ * Behaviors never call Robot::read() themselves: whoever resumes them has
+ * already read for the tick. A behavior can run another one as part of itself
+ * by resuming it once per tick:
+ *
+ *   Behavior child = autoPilotBehavior(robot, 50);
+ *   while (child.resume()) co_yield NextTick();
+ */
+class Behavior
+{
+public:
+  struct promise_type
+  {
+    Behavior get_return_object() { return Behavior(std::coroutine_handle<promise_type>::from_promise(*this)); }
+    std::suspend_always initial_suspend() noexcept { return std::suspend_always(); }
+    std::suspend_always final_suspend() noexcept   { return std::suspend_always(); }
+    std::suspend_always yield_value(NextTick) noexcept { return std::suspend_always(); }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+
+private:
+  std::coroutine_handle<promise_type> handle;
+  std::string   name;
+  double        cpuTime;     // thread CPU time spent in the behavior in seconds
+  unsigned long resumeCount; // number of ticks the behavior has run for
+
+  explicit Behavior(std::coroutine_handle<promise_type> handle);
+
+public:
+  // only ever moved, as there is only one coroutine frame to own
+  Behavior(Behavior&& other) noexcept;
+  Behavior& operator=(Behavior&& other) noexcept;
+  Behavior(const Behavior&) = delete;
+  Behavior& operator=(const Behavior&) = delete;
+
+  // destructor
+  ~Behavior();
+
+  // running
+  bool resume();
+  bool isDone() const;
+
+  // statistics
+  void setName(const std::string& name);
+  const std::string& getName() const;
+  double getCpuTime() const;
+  unsigned long getResumeCount() const;
+};
+
+/**
+ * Runs any number of behaviors side by side on one thread. Every tick it reads
+ * once for all of them, then resumes each running behavior in the order they
+ * were added until it yields. Behaviors that finish are kept so their CPU
+ * time can still be printed. Behaviors may add more behaviors while they run.
+ */
+class BehaviorScheduler
+{
+  Robot& robot;
+  std::deque<Behavior> behaviors; // a deque so behaviors added during a tick never move the ones running
+
+public:
+  // constructor
+  BehaviorScheduler(Robot& robot);
+
+  // behaviors
+  void add(Behavior behavior, const std::string& name);
+  int getRunningCount() const;
+
+  // running
+  bool step();
+  void run(int tickLimit = INT_MAX);
+
+  // statistics
+  void printStats() const;
+};
+
+// behaviors that used to be blocking loops
+Behavior localizeBehavior(Robot& robot);
+Behavior autoPilotBehavior(Robot& robot, int tickDuration = INT_MAX, double forwardVelocity = 0.5, double angularVelocity = 1.0);
+
+#endif
@@ -0,0 +1,647 @@
+#include "BehaviorTree.h"
+#include "LatencyHistogram.h"
+#include <algorithm> // std::min
+#include <iostream>
+
+const double FACING_RANGE  = 0.1; // radians off the waypoint the robot may be before it stops to turn
+const double STEERING_GAIN = 2.0; // rad/s turned for every radian off the waypoint while driving
+const double DEAD_END      = 0.3; // meters free on both sides of the laser that count as a dead end
+
+/**
+ * Creates a node with no children and nothing set
+ *
+ * @param type   - the kind of node
+ * @param parent - index of the node's parent, or -1 for the root
+ */
+BehaviorNode::BehaviorNode(NodeType::Enum type, int parent) :
+  type(type),
+  status(NodeStatus::Failure),
+  isActive(false),
+  parent(parent),
+  firstChild(-1),
+  lastChild(-1),
+  nextSibling(-1),
+  seconds(0),
+  distance(0),
+  velocity(0),
+  angularVelocity(0),
+  errorRange(0),
+  count(0),
+  condition(NULL),
+  action(NULL),
+  data(NULL),
+  current(-1),
+  tickCount(0),
+  startTime(0) {}
+
+/**
+ * Creates an empty tree. The first node added is its root
+ *
+ * @param robot    - the robot the tree controls
+ * @param capacity - number of nodes to make room for up front
+ */
+BehaviorTree::BehaviorTree(Robot& robot, int capacity) :
+  robot(robot)
+{
+  nodes.reserve(capacity);
+}
+
+/**
+ * Adds a node as the last child of its parent
+ *
+ * @param type   - the kind of node
+ * @param parent - index of the parent, or -1 to add the root
+ * @return index of the new node, or -1 if it could not be added
+ */
+int BehaviorTree::addNode(NodeType::Enum type, int parent)
+{
+  if (parent < 0 && !nodes.empty())
+  {
+    std::cout << "The behavior tree already has a root. Give the node a parent\n";
+    return -1;
+  }
+
+  if (parent >= (int)nodes.size())
+  {
+    std::cout << "No node " << parent << " to add a child to\n";
+    return -1;
+  }
+
+  if (parent >= 0)
+  {
+    const BehaviorNode& node = nodes[parent];
+
+    if (node.type >= NodeType::Condition)
+    {
+      std::cout << "Leaf nodes cannot have children\n";
+      return -1;
+    }
+
+    if (node.type >= NodeType::Timeout && node.firstChild != -1)
+    {
+      std::cout << "Decorator nodes only have a single child\n";
+      return -1;
+    }
+  }
+
+  int index = nodes.size();
+  nodes.push_back(BehaviorNode(type, parent));
+
+  // link the node in after its parent's last child
+  if (parent >= 0)
+  {
+    BehaviorNode& node = nodes[parent];
+    if (node.lastChild == -1) node.firstChild = index;
+    else                      nodes[node.lastChild].nextSibling = index;
+    node.lastChild = index;
+  }
+
+  return index;
+}
+
+/**
+ * Adds a sequence, which ticks its children one after another. It carries on
+ * from whichever child was running last tick, and fails as soon as one fails.
+ *
+ * @param parent - index of the parent, or -1 to add the root
+ * @return index of the new node, or -1 if it could not be added
+ */
+int BehaviorTree::addSequence(int parent)
+{
+  return addNode(NodeType::Sequence, parent);
+}
+
+/**
+ * Adds a fallback, which tries its children one after another until one does
+ * not fail. It starts from its first child every tick, and stops any later
+ * child that was running once an earlier one takes over.
+ *
+ * @param parent - index of the parent, or -1 to add the root
+ * @return index of the new node, or -1 if it could not be added
+ */
+int BehaviorTree::addFallback(int parent)
+{
+  return addNode(NodeType::Fallback, parent);
+}
+
+/**
+ * Adds a parallel, which ticks every unfinished child each tick. It succeeds
+ * once enough children succeed and fails once too many fail for that to happen.
+ *
+ * @param successCount - number of children that have to succeed
+ * @param parent       - index of the parent, or -1 to add the root
+ * @return index of the new node, or -1 if it could not be added
+ */
+int BehaviorTree::addParallel(int successCount, int parent)
+{
+  int index = addNode(NodeType::Parallel, parent);
+  if (index >= 0) nodes[index].count = successCount;
+  return index;
+}
+
+/**
+ * Adds a timeout, which stops its child and fails if the child runs too long
+ *
+ * @param seconds - longest the child may run for
+ * @param parent  - index of the parent, or -1 to add the root
+ * @return index of the new node, or -1 if it could not be added
+ */
+int BehaviorTree::addTimeout(double seconds, int parent)
+{
+  int index = addNode(NodeType::Timeout, parent);
+  if (index >= 0) nodes[index].seconds = seconds;
+  return index;
+}
+
+/**
+ * Adds an inverter, which succeeds when its child fails and fails when it succeeds
+ *
+ * @param parent - index of the parent, or -1 to add the root
+ * @return index of the new node, or -1 if it could not be added
+ */
+int BehaviorTree::addInverter(int parent)
+{
+  return addNode(NodeType::Inverter, parent);
+}
+
+/**
+ * Adds a repeat, which starts its child again each time it succeeds and fails
+ * as soon as it fails
+ *
+ * @param count  - number of times the child has to succeed
+ * @param parent - index of the parent, or -1 to add the root
+ * @return index of the new node, or -1 if it could not be added
+ */
+int BehaviorTree::addRepeat(int count, int parent)
+{
+  int index = addNode(NodeType::Repeat, parent);
+  if (index >= 0) nodes[index].count = count;
+  return index;
+}
+
+/**
+ * Adds a node that fails once its child is done. Under a fallback this runs
+ * the child, then moves on to the next option as if it had never run.
+ *
+ * @param parent - index of the parent, or -1 to add the root
+ * @return index of the new node, or -1 if it could not be added
+ */
+int BehaviorTree::addForceFailure(int parent)
+{
+  return addNode(NodeType::ForceFailure, parent);
+}
+
+/**
+ * Adds a condition, which succeeds or fails on the tick it is reached
+ *
+ * @param condition - returns true for success, e.g. isBumperPressed
+ * @param parent    - index of the parent, or -1 to add the root
+ * @return index of the new node, or -1 if it could not be added
+ */
+int BehaviorTree::addCondition(ConditionFunction condition, int parent)
+{
+  int index = addNode(NodeType::Condition, parent);
+  if (index >= 0) nodes[index].condition = condition;
+  return index;
+}
+
+/**
+ * Adds an action that runs a function every tick until it returns a result
+ *
+ * @param action - ticks the action. Its node keeps tickCount, startTime and data
+ * @param data   - anything the action wants to keep between ticks
+ * @param parent - index of the parent, or -1 to add the root
+ * @return index of the new node, or -1 if it could not be added
+ */
+int BehaviorTree::addAction(ActionFunction action, void *data, int parent)
+{
+  int index = addNode(NodeType::Action, parent);
+  if (index >= 0)
+  {
+    nodes[index].action = action;
+    nodes[index].data   = data;
+  }
+  return index;
+}
+
+/**
+ * Adds a leaf that turns to face the waypoint then drives to it, steering to
+ * stay facing it on the way, like Robot::moveToWaypoint(). It succeeds once
+ * the robot is within the error range. Bumps are left to the rest of the tree.
+ *
+ * @param wp              - the waypoint for the robot to move to
+ * @param velocity        - velocity for the robot to move in m/s
+ * @param angularVelocity - angular velocity for the robot to rotate in rad/s
+ * @param errorRange      - minimum distance robot must be from waypoint in meters
+ * @param parent          - index of the parent, or -1 to add the root
+ * @return index of the new node, or -1 if it could not be added
+ */
+int BehaviorTree::addMoveToWaypoint(Vector2 wp, double velocity, double angularVelocity, double errorRange, int parent)
+{
+  int index = addNode(NodeType::MoveToWaypoint, parent);
+  if (index >= 0)
+  {
+    BehaviorNode& node   = nodes[index];
+    node.target          = wp;
+    node.velocity        = velocity;
+    node.angularVelocity = angularVelocity;
+    node.errorRange      = errorRange;
+  }
+  return index;
+}
+
+/**
+ * Adds a leaf that reverses by the given distance, like
+ * Robot::dislodgeFromObstacle(). It succeeds once the odometer has covered
+ * the distance.
+ *
+ * @param distance - the total distance to reverse
+ * @param velocity - the velocity to reverse at
+ * @param parent   - index of the parent, or -1 to add the root
+ * @return index of the new node, or -1 if it could not be added
+ */
+int BehaviorTree::addDislodge(double distance, double velocity, int parent)
+{
+  int index = addNode(NodeType::Dislodge, parent);
+  if (index >= 0)
+  {
+    nodes[index].distance = distance;
+    nodes[index].velocity = velocity;
+  }
+  return index;
+}
+
+/**
+ * Adds a leaf that steers away from whichever side of the laser is closer,
+ * like Robot::autoPilotLaser(). It succeeds after the given number of ticks,
+ * and fails at a dead end or if the robot has no laser.
+ *
+ * @param tickDuration    - the number of ticks to apply auto pilot for
+ * @param forwardVelocity - velocity that the robot moves forward at in m/s
+ * @param angularVelocity - angular velocity that the robot rotates at in rad/s
+ * @param parent          - index of the parent, or -1 to add the root
+ * @return index of the new node, or -1 if it could not be added
+ */
+int BehaviorTree::addAutoPilot(int tickDuration, double forwardVelocity, double angularVelocity, int parent)
+{
+  int index = addNode(NodeType::AutoPilot, parent);
+  if (index >= 0)
+  {
+    BehaviorNode& node   = nodes[index];
+    node.count           = tickDuration;
+    node.velocity        = forwardVelocity;
+    node.angularVelocity = angularVelocity;
+  }
+  return index;
+}
+
+/**
+ * @param index - index of the node
+ * @return the node, e.g. to change a waypoint between runs
+ */
+BehaviorNode& BehaviorTree::getNode(int index)
+{
+  return nodes[index];
+}
+
+/** @return number of nodes in the tree */
+int BehaviorTree::getNodeCount() const
+{
+  return nodes.size();
+}
+
+/**
+ * Ticks a node, starting it first if it was not already running
+ *
+ * @param index - index of the node
+ * @return the node's result this tick
+ */
+NodeStatus::Enum BehaviorTree::tickNode(int index)
+{
+  BehaviorNode& node = nodes[index];
+
+  if (!node.isActive)
+  {
+    node.isActive  = true;
+    node.current   = node.type == NodeType::Sequence ? node.firstChild : 0;
+    node.tickCount = 0;
+    node.startTime = robot.getState().captureTime;
+    node.startPos  = robot.getOdometerPos();
+
+    // a parallel's children have not given a result yet this time around
+    if (node.type == NodeType::Parallel)
+    {
+      for (int child = node.firstChild; child != -1; child = nodes[child].nextSibling)
+      {
+        nodes[child].status = NodeStatus::Running;
+      }
+    }
+  }
+
+  NodeStatus::Enum status = node.type <= NodeType::Parallel ? tickComposite(index) :
+                            node.type <  NodeType::Condition ? tickDecorator(index) : tickLeaf(node);
+
+  node.tickCount++;
+  node.status = status;
+  if (status != NodeStatus::Running) node.isActive = false;
+
+  return status;
+}
+
+/**
+ * Ticks a sequence, fallback or parallel
+ *
+ * @param index - index of the node
+ * @return the node's result this tick
+ */
+NodeStatus::Enum BehaviorTree::tickComposite(int index)
+{
+  BehaviorNode& node = nodes[index];
+
+  switch (node.type)
+  {
+    case NodeType::Sequence:
+      // carry on from the child that was running, moving straight on whenever one succeeds
+      while (node.current != -1)
+      {
+        NodeStatus::Enum status = tickNode(node.current);
+        if (status != NodeStatus::Success) return status;
+        node.current = nodes[node.current].nextSibling;
+      }
+      return NodeStatus::Success;
+
+    case NodeType::Fallback:
+      for (int child = node.firstChild; child != -1; child = nodes[child].nextSibling)
+      {
+        NodeStatus::Enum status = tickNode(child);
+        if (status == NodeStatus::Failure) continue;
+
+        // an earlier child has taken over from any later one that was running
+        haltSiblings(nodes[child].nextSibling);
+        return status;
+      }
+      return NodeStatus::Failure;
+
+    case NodeType::Parallel:
+    {
+      int successes = 0,
+          failures  = 0,
+          children  = 0;
+
+      for (int child = node.firstChild; child != -1; child = nodes[child].nextSibling)
+      {
+        NodeStatus::Enum status = nodes[child].status;
+        if (status == NodeStatus::Running) status = tickNode(child);
+
+        children++;
+        if      (status == NodeStatus::Success) successes++;
+        else if (status == NodeStatus::Failure) failures++;
+      }
+
+      if (successes < node.count && children - failures >= node.count) return NodeStatus::Running;
+
+      haltSiblings(node.firstChild);
+      return successes >= node.count ? NodeStatus::Success : NodeStatus::Failure;
+    }
+
+    default:
+      return NodeStatus::Failure;
+  }
+}
+
+/**
+ * Ticks a timeout, inverter, repeat or force failure
+ *
+ * @param index - index of the node
+ * @return the node's result this tick
+ */
+NodeStatus::Enum BehaviorTree::tickDecorator(int index)
+{
+  BehaviorNode& node = nodes[index];
+  int child = node.firstChild;
+
+  if (child == -1) return NodeStatus::Failure;
+
+  // stop the child before it gets another tick
+  if (node.type == NodeType::Timeout && robot.getState().captureTime - node.startTime > node.seconds)
+  {
+    halt(child);
+    return NodeStatus::Failure;
+  }
+
+  NodeStatus::Enum status = tickNode(child);
+
+  switch (node.type)
+  {
+    case NodeType::Inverter:
+      if (status == NodeStatus::Running) return status;
+      return status == NodeStatus::Success ? NodeStatus::Failure : NodeStatus::Success;
+
+    case NodeType::Repeat:
+      if (status != NodeStatus::Success) return status;
+
+      // the child starts over on the next tick
+      return ++node.current >= node.count ? NodeStatus::Success : NodeStatus::Running;
+
+    case NodeType::ForceFailure:
+      return status == NodeStatus::Running ? status : NodeStatus::Failure;
+
+    default:
+      return status;
+  }
+}
+
+/**
+ * Ticks a leaf. Leaves act on the snapshot the tree read this tick
+ *
+ * @param node - the leaf
+ * @return the leaf's result this tick
+ */
+NodeStatus::Enum BehaviorTree::tickLeaf(BehaviorNode& node)
+{
+  const RobotState& state = robot.getState();
+
+  switch (node.type)
+  {
+    case NodeType::Condition:
+      return node.condition && node.condition(robot) ? NodeStatus::Success : NodeStatus::Failure;
+
+    case NodeType::Action:
+      return node.action ? node.action(robot, node) : NodeStatus::Failure;
+
+    case NodeType::MoveToWaypoint:
+    {
+      if (robot.hasReachedWaypoint(node.target, node.errorRange))
+      {
+        robot.setSpeed(0, 0, TurnDirection::None);
+        return NodeStatus::Success;
+      }
+
+      Vector2 pos      = robot.getPos();
+      double  dx       = node.target.x - pos.x,
+              dy       = node.target.y - pos.y,
+              angle    = robot.clampYawToPi(atan2(dy, dx) - robot.getYaw()),
+              distance = sqrt(dx * dx + dy * dy);
+
+      // face the waypoint before driving to it
+      if (fabs(angle) > FACING_RANGE)
+      {
+        robot.setSpeed(0, node.angularVelocity, angle > 0 ? TurnDirection::Left : TurnDirection::Right);
+      }
+      // slow down over the last meter so the robot does not overshoot
+      else
+      {
+        double turn = std::min(node.angularVelocity, fabs(angle) * STEERING_GAIN);
+        robot.setSpeed(std::min(node.velocity, distance), turn, angle > 0 ? TurnDirection::Left : TurnDirection::Right);
+      }
+      return NodeStatus::Running;
+    }
+
+    case NodeType::Dislodge:
+    {
+      Vector2 pos = robot.getOdometerPos();
+      double  dx  = pos.x - node.startPos.x,
+              dy  = pos.y - node.startPos.y;
+
+      if (sqrt(dx * dx + dy * dy) >= node.distance)
+      {
+        robot.setSpeed(0, 0, TurnDirection::None);
+        return NodeStatus::Success;
+      }
+
+      robot.setSpeed(-node.velocity, 0, TurnDirection::None);
+      return NodeStatus::Running;
+    }
+
+    case NodeType::AutoPilot:
+    {
+      if (state.laserRanges.empty()) return NodeStatus::Failure;
+
+      bool isStuck = isDeadEnd(robot);
+
+      if (isStuck || node.tickCount >= node.count)
+      {
+        robot.setSpeed(0, 0, TurnDirection::None);
+        return isStuck ? NodeStatus::Failure : NodeStatus::Success;
+      }
+
+      TurnDirection::Enum dir = state.laserMinRight < state.laserMinLeft ? TurnDirection::Left : TurnDirection::Right;
+      robot.setSpeed(node.velocity, node.angularVelocity, dir);
+      return NodeStatus::Running;
+    }
+
+    default:
+      return NodeStatus::Failure;
+  }
+}
+
+/**
+ * Stops a running node and everything running beneath it, so it starts over
+ * the next time it is ticked
+ *
+ * @param index - index of the node
+ */
+void BehaviorTree::halt(int index)
+{
+  BehaviorNode& node = nodes[index];
+  if (!node.isActive) return;
+
+  node.isActive = false;
+  haltSiblings(node.firstChild);
+}
+
+/**
+ * Halts a node and every sibling after it
+ *
+ * @param first - index of the first node to halt, or -1 for none
+ */
+void BehaviorTree::haltSiblings(int first)
+{
+  for (int index = first; index != -1; index = nodes[index].nextSibling) halt(index);
+}
+
+/**
+ * Reads once, then ticks the whole tree
+ *
+ * @return the root's result this tick
+ */
+NodeStatus::Enum BehaviorTree::tick()
+{
+  robot.read();
+
+  if (nodes.empty()) return NodeStatus::Failure;
+  return tickNode(0);
+}
+
+/**
+ * Ticks the tree until the root gives a result, then stops the robot
+ *
+ * @param tickLimit - the most ticks to run for
+ * @return the root's result, or Running if it ran out of ticks or was cancelled
+ */
+NodeStatus::Enum BehaviorTree::run(int tickLimit)
+{
+  NodeStatus::Enum status = NodeStatus::Running;
+
+  for (int i = 0; i < tickLimit && status == NodeStatus::Running && !robot.isMotionCancelled(); i++)
+  {
+    status = tick();
+  }
+
+  if (status == NodeStatus::Running) reset();
+  robot.setSpeed(0, 0, TurnDirection::None);
+
+  return status;
+}
+
+/** Stops every running node, so the next tick starts the tree from the top */
+void BehaviorTree::reset()
+{
+  if (!nodes.empty()) halt(0);
+}
+
+/**
+ * Constructor for a new BehaviorTreeBumper object
+ *
+ * @param tree      - what to do about the bump. Must outlive the handler
+ * @param tickLimit - the most ticks to run the tree for
+ */
+BehaviorTreeBumper::BehaviorTreeBumper(BehaviorTree& tree, int tickLimit) :
+  BumperEventState(0, 0, 0),
+  tree(tree),
+  tickLimit(tickLimit) {}
+
+/**
+ * Runs the tree from the top until it gives a result
+ *
+ * @param robot - the robot whose bumper was pressed
+ */
+void BehaviorTreeBumper::handleBump(Robot *robot)
+{
+  // if no bumpers were pressed, return
+  if (!robot->isAnyPressed()) return;
+
+  TIME_STAGE(ProfileStage::HandleBump);
+
+  tree.reset();
+  tree.run(tickLimit);
+}
+
+/**
+ * @param robot - the robot to check
+ * @return true if either bumper was pressed as of the last read
+ */
+bool isBumperPressed(Robot& robot)
+{
+  return robot.getState().isAnyPressed;
+}
+
+/**
+ * @param robot - the robot to check
+ * @return true if the laser sees something close on both sides as of the last read
+ */
+bool isDeadEnd(Robot& robot)
+{
+  const RobotState& state = robot.getState();
+  return !state.laserRanges.empty() && state.laserMinLeft < DEAD_END && state.laserMinRight < DEAD_END;
+}
@@ -0,0 +1,187 @@
+#ifndef BEHAVIOR_TREE_H
+#define BEHAVIOR_TREE_H
+#pragma once
+
+#include <climits> // INT_MAX
+#include <vector>
+#include "Robot.h"
+#include "Vector2.h"
+
+/**
+ * Result of ticking a node
+ */
+namespace NodeStatus
+{
+  enum Enum { Running, Success, Failure };
+}
+
+/**
+ * Every kind of node a BehaviorTree can hold. Composites and decorators
+ * decide which of their children to tick, leaves act on the robot.
+ */
+namespace NodeType
+{
+  enum Enum
+  {
+    // composites
+    Sequence,       // ticks its children in order, fails as soon as one fails
+    Fallback,       // ticks its children in order, succeeds as soon as one succeeds
+    Parallel,       // ticks every child each tick until enough of them succeed
+
+    // decorators
+    Timeout,        // fails if its child takes too long
+    Inverter,       // swaps its child's success and failure
+    Repeat,         // runs its child again each time it succeeds
+    ForceFailure,   // fails once its child is done, however it did
+
+    // leaves
+    Condition,      // succeeds or fails straight away depending on a function
+    Action,         // runs a function once every tick until it returns a result
+    MoveToWaypoint, // Robot::moveToWaypoint()
+    Dislodge,       // Robot::dislodgeFromObstacle()
+    AutoPilot       // Robot::autoPilotLaser()
+  };
+}
+
+struct BehaviorNode;
+
+// functions leaves can be built from. Neither may read from the robot
+typedef bool (*ConditionFunction)(Robot& robot);
+typedef NodeStatus::Enum (*ActionFunction)(Robot& robot, BehaviorNode& node);
+
+/**
+ * A single node of a BehaviorTree. Nodes refer to each other by their index
+ * in the tree, and hold everything they need from one tick to the next, so
+ * ticking a tree never allocates.
+ */
+struct BehaviorNode
+{
+  NodeType::Enum   type;
+  NodeStatus::Enum status;   // result of the last tick
+  bool             isActive; // true from the node's first tick until it gives a result
+
+  // links to other nodes, or -1 for none
+  int parent,
+      firstChild,
+      lastChild,
+      nextSibling;
+
+  // set when the node is built
+  Vector2           target;          // waypoint to move to
+  double            seconds,         // longest a timeout's child may run for
+                    distance,        // distance to reverse when dislodging in meters
+                    velocity,        // m/s
+                    angularVelocity, // rad/s
+                    errorRange;      // how close to the waypoint counts as reaching it in meters
+  int               count;           // children a parallel needs to succeed, or times to repeat
+  ConditionFunction condition;
+  ActionFunction    action;
+  void             *data;            // anything an action function wants to keep
+
+  // progress while the node is active
+  int     current;    // child being ticked by a sequence, or repeats done so far
+  int     tickCount;  // ticks since the node started
+  double  startTime;  // snapshot time the node started at in seconds
+  Vector2 startPos;   // odometer position the node started at
+
+  BehaviorNode(NodeType::Enum type, int parent);
+};
+
+/**
+ * Decides what the robot does every tick by walking a tree of nodes, in place
+ * of a blocking loop per behavior. Every node is kept side by side in one
+ * array that is filled up before the tree runs, so ticking it at the control
+ * rate never allocates.
+ *
+ * Sequences remember which child they were on and carry on from it next tick.
+ * Fallbacks start from their first child every tick, so a condition earlier
+ * on can take over from a running action later on, e.g. reacting to a bumper
+ * halfway to a waypoint then carrying on to it:
+ *
+ *   BehaviorTree tree(robot);
+ *   int root    = tree.addFallback();
+ *   int recover = tree.addSequence(tree.addForceFailure(root));
+ *   tree.addCondition(isBumperPressed, recover);
+ *   tree.addDislodge(0.5, 0.5, recover);
+ *   tree.addAutoPilot(50, 0.5, 1.0, recover);
+ *   tree.addMoveToWaypoint(Vector2(6, 4), 0.5, 0.5, 0.25, root);
+ *   tree.run();
+ *
+ * Leaves never read from the robot; the tree reads once per tick before
+ * ticking the root.
+ */
+class BehaviorTree
+{
+  Robot& robot;
+  std::vector<BehaviorNode> nodes; // the first node is the root
+
+  // building
+  int addNode(NodeType::Enum type, int parent);
+
+  // ticking
+  NodeStatus::Enum tickNode(int index);
+  NodeStatus::Enum tickComposite(int index);
+  NodeStatus::Enum tickDecorator(int index);
+  NodeStatus::Enum tickLeaf(BehaviorNode& node);
+  void halt(int index);
+  void haltSiblings(int first);
+
+public:
+  // constructor
+  BehaviorTree(Robot& robot, int capacity = 64);
+
+  // composites
+  int addSequence(int parent = -1);
+  int addFallback(int parent = -1);
+  int addParallel(int successCount, int parent = -1);
+
+  // decorators
+  int addTimeout(double seconds, int parent = -1);
+  int addInverter(int parent = -1);
+  int addRepeat(int count = INT_MAX, int parent = -1);
+  int addForceFailure(int parent = -1);
+
+  // leaves
+  int addCondition(ConditionFunction condition, int parent = -1);
+  int addAction(ActionFunction action, void *data = NULL, int parent = -1);
+  int addMoveToWaypoint(Vector2 wp,
+                        double velocity        = 0.5,
+                        double angularVelocity = 0.5,
+                        double errorRange      = 0.25,
+                        int    parent          = -1);
+  int addDislodge(double distance = 0.5, double velocity = 0.5, int parent = -1);
+  int addAutoPilot(int    tickDuration    = INT_MAX,
+                   double forwardVelocity = 0.5,
+                   double angularVelocity = 1.0,
+                   int    parent          = -1);
+
+  // access
+  BehaviorNode& getNode(int index);
+  int getNodeCount() const;
+
+  // running
+  NodeStatus::Enum tick();
+  NodeStatus::Enum run(int tickLimit = INT_MAX);
+  void reset();
+};
+
+/**
+ * Runs a behavior tree whenever a bumper is pressed, so any tree can be
+ * handed to moveToWaypoint() or followPath() in place of the hard-wired
+ * reactions above.
+ */
+struct BehaviorTreeBumper : public BumperEventState
+{
+  BehaviorTree& tree; // what to do about the bump
+  int tickLimit;      // the most ticks to run the tree for
+
+  BehaviorTreeBumper(BehaviorTree& tree, int tickLimit = 100);
+
+  void handleBump(Robot *robot);
+};
+
+// conditions for building trees with
+bool isBumperPressed(Robot& robot);
+bool isDeadEnd(Robot& robot);
+
+#endif
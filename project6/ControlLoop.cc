@@ -0,0 +1,160 @@
+#include "ControlLoop.h"
+#include <cmath>    // fabs, sqrt
+#include <cstdio>   // printf
+#include <errno.h>  // EINTR
+
+/**
+ * @param time - a point in time
+ * @return the time in seconds
+ */
+static double toSeconds(const timespec& time)
+{
+  return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+/**
+ * @param time    - a point in time
+ * @param seconds - seconds to add to it
+ * @return the point in time that many seconds later
+ */
+static timespec addSeconds(timespec time, double seconds)
+{
+  long nanoseconds = (long)(seconds * 1e9);
+
+  time.tv_sec  += nanoseconds / 1000000000L;
+  time.tv_nsec += nanoseconds % 1000000000L;
+  if (time.tv_nsec >= 1000000000L)
+  {
+    time.tv_sec++;
+    time.tv_nsec -= 1000000000L;
+  }
+
+  return time;
+}
+
+/**
+ * Creates a new loop. Nothing is timed until the first tick.
+ *
+ * @param period - time between ticks in seconds
+ */
+ControlLoop::ControlLoop(double period) :
+  period(period),
+  hasStarted(false)
+{
+  resetStats();
+}
+
+/**
+ * Starts the loop over so the next tick is timed as the first one. Call when
+ * a motion starts after the loop was left idle, otherwise the whole idle time
+ * is counted as one late tick.
+ */
+void ControlLoop::reset()
+{
+  hasStarted = false;
+}
+
+/**
+ * Sleeps until the next tick is due then starts it. If the deadline has
+ * already passed the tick starts straight away and counts as a miss, and the
+ * deadlines after it are pushed back so the loop does not try to catch up.
+ *
+ * @return measured time since the last tick started in seconds, or the period
+ *         on the first tick after construction or reset()
+ */
+double ControlLoop::waitForNextTick()
+{
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  if (!hasStarted)
+  {
+    hasStarted   = true;
+    lastTick     = now;
+    nextDeadline = addSeconds(now, period);
+    return period;
+  }
+
+  double late = toSeconds(now) - toSeconds(nextDeadline);
+
+  if (late > 0)
+  {
+    missCount++;
+    nextDeadline = now;
+  }
+  else
+  {
+    // TIMER_ABSTIME sleeps until the deadline itself, so waking late here never accumulates
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &nextDeadline, NULL) == EINTR) {}
+    clock_gettime(CLOCK_MONOTONIC, &now);
+  }
+
+  nextDeadline = addSeconds(nextDeadline, period);
+
+  // measure how long the tick really took
+  double dt     = toSeconds(now) - toSeconds(lastTick),
+         jitter = fabs(dt - period);
+  lastTick = now;
+
+  tickCount++;
+  periodSum   += dt;
+  jitterSqSum += jitter * jitter;
+  if (jitter > maxJitter) maxJitter = jitter;
+
+  return dt;
+}
+
+/** @return time between ticks in seconds */
+double ControlLoop::getPeriod() const
+{
+  return period;
+}
+
+/** @return number of ticks measured since the last reset */
+unsigned long ControlLoop::getTickCount() const
+{
+  return tickCount;
+}
+
+/** @return number of ticks that started after their deadline since the last reset */
+unsigned long ControlLoop::getMissCount() const
+{
+  return missCount;
+}
+
+/** @return average measured time between ticks in seconds */
+double ControlLoop::getMeanPeriod() const
+{
+  return tickCount ? periodSum / tickCount : period;
+}
+
+/** @return root mean square difference between the measured and wanted period in seconds */
+double ControlLoop::getJitter() const
+{
+  return tickCount ? sqrt(jitterSqSum / tickCount) : 0;
+}
+
+/** @return largest difference between the measured and wanted period in seconds */
+double ControlLoop::getMaxJitter() const
+{
+  return maxJitter;
+}
+
+/** Clears every statistic without changing when the next tick is due */
+void ControlLoop::resetStats()
+{
+  tickCount   = 0;
+  missCount   = 0;
+  periodSum   = 0;
+  jitterSqSum = 0;
+  maxJitter   = 0;
+}
+
+/** Prints how well the loop has kept to its period */
+void ControlLoop::printStats() const
+{
+  printf("Control loop: %lu ticks, %lu deadline misses, period %.1f ms (wanted %.1f ms), "
+         "jitter %.2f ms rms / %.2f ms max\n",
+         tickCount, missCount, getMeanPeriod() * 1e3, period * 1e3,
+         getJitter() * 1e3, maxJitter * 1e3);
+}
@@ -0,0 +1,51 @@
+#ifndef CONTROL_LOOP_H
+#define CONTROL_LOOP_H
+#pragma once
+
+#include <time.h> // timespec
+
+/**
+ * Paces a control loop at a fixed rate off of the monotonic clock. Each tick
+ * sleeps until an absolute deadline with clock_nanosleep(), so time spent
+ * working during a tick does not push every later tick back.
+ *
+ * The real time between ticks is measured and handed back so motion can be
+ * worked out from how long a tick actually took rather than how long it was
+ * meant to take. Ticks that start after their deadline are counted as misses,
+ * however late they are, so callers reset() the loop when they start using it
+ * again after leaving it idle.
+ */
+class ControlLoop
+{
+  double   period;       // time between ticks in seconds
+  timespec nextDeadline, // when the next tick is due to start
+           lastTick;     // when the last tick started
+  bool     hasStarted;   // false until the first tick
+
+  // statistics
+  unsigned long tickCount,   // ticks measured since the last reset
+                missCount;   // ticks that started after their deadline
+  double        periodSum,   // sum of the measured periods
+                jitterSqSum, // sum of the squared differences from the period
+                maxJitter;   // largest difference from the period
+
+public:
+  // constructor
+  ControlLoop(double period = 0.1);
+
+  // pacing
+  void reset();
+  double waitForNextTick();
+  double getPeriod() const;
+
+  // statistics
+  unsigned long getTickCount() const;
+  unsigned long getMissCount() const;
+  double getMeanPeriod() const;
+  double getJitter() const;
+  double getMaxJitter() const;
+  void resetStats();
+  void printStats() const;
+};
+
+#endif
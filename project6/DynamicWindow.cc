@@ -0,0 +1,188 @@
+#include "DynamicWindow.h"
+#include <algorithm> // std::min, std::max
+#include <cmath>     // atan2, cos, sin, fabs, sqrt, ceil, M_PI
+
+const double PREDICT_TIME     = 2.0; // seconds of travel at top speed each pair is rolled out for
+const int    PREDICT_STEPS    = 20;  // fewest points checked along each roll out
+const double MAX_STEP_TURN    = 0.2; // most the heading turns between two points checked, in radians
+const double HEADING_TIME     = 1.0; // seconds along a roll out the heading to the goal is judged at
+const int    VELOCITY_SAMPLES = 7;   // forward velocities tried across the window
+const int    ANGULAR_SAMPLES  = 21;  // angular velocities tried across the window
+const double SAFETY_MARGIN    = 0.05; // extra meters kept between the robot and anything it passes
+
+// how much each part of the score counts for. Each part is between 0 and 1
+const double HEADING_WEIGHT   = 1.0;
+const double CLEARANCE_WEIGHT = 0.4;
+const double VELOCITY_WEIGHT  = 0.3;
+
+/**
+ * Creates a new planner for a robot with the given limits
+ *
+ * @param maxVelocity            - forward velocity limit in m/s
+ * @param maxAngularVelocity     - angular velocity limit in rad/s
+ * @param maxAcceleration        - forward acceleration limit in m/s^2
+ * @param maxAngularAcceleration - angular acceleration limit in rad/s^2
+ * @param robotRadius            - radius of the robot in meters
+ */
+DynamicWindowPlanner::DynamicWindowPlanner(double maxVelocity,
+                                           double maxAngularVelocity,
+                                           double maxAcceleration,
+                                           double maxAngularAcceleration,
+                                           double robotRadius) :
+  maxVelocity(maxVelocity),
+  maxAngularVelocity(maxAngularVelocity),
+  maxAcceleration(maxAcceleration),
+  maxAngularAcceleration(maxAngularAcceleration),
+  robotRadius(robotRadius),
+  sampleCount(0) {}
+
+/**
+ * Takes in the latest laser scan. Only beams that hit something within reach
+ * of a roll out are kept.
+ *
+ * @param ranges   - distance measured by each beam in meters
+ * @param bearings - angle of each beam relative to the robot in radians
+ * @param maxRange - maximum range of the laser in meters
+ */
+void DynamicWindowPlanner::setScan(const std::vector<double>& ranges,
+                                   const std::vector<double>& bearings,
+                                   double maxRange)
+{
+  double reach = maxVelocity * PREDICT_TIME + robotRadius + SAFETY_MARGIN;
+
+  obstacleX.clear();
+  obstacleY.clear();
+
+  for (int i = 0; i < (int)ranges.size(); i++)
+  {
+    if (ranges[i] >= maxRange || ranges[i] > reach) continue;
+
+    obstacleX.push_back(ranges[i] * cos(bearings[i]));
+    obstacleY.push_back(ranges[i] * sin(bearings[i]));
+  }
+}
+
+/**
+ * Rolls the robot out along the arc of a velocity pair and finds how far it
+ * gets before touching an obstacle. Every arc is rolled out for the same
+ * distance no matter the velocity, so arcs are judged by where they go rather
+ * than by how slowly they get there. Points are placed exactly on the arc and
+ * close enough together that the heading never turns by more than
+ * MAX_STEP_TURN between them, however tight the arc is.
+ *
+ * @param velocity        - forward velocity in m/s
+ * @param angularVelocity - angular velocity in rad/s
+ * @return distance along the arc that is free of obstacles in meters, at most
+ *         the length of a roll out. 0 when turning in place
+ */
+double DynamicWindowPlanner::getFreeDistance(double velocity, double angularVelocity) const
+{
+  if (velocity <= 0) return 0;
+
+  double rollout   = maxVelocity * PREDICT_TIME,
+         curvature = angularVelocity / velocity,
+         radiusSqr = (robotRadius + SAFETY_MARGIN) * (robotRadius + SAFETY_MARGIN),
+         length    = rollout;
+
+  // past a full circle the arc only goes over the same ground again
+  if (fabs(curvature) * length > 2.0 * M_PI) length = 2.0 * M_PI / fabs(curvature);
+
+  int    steps = std::max(PREDICT_STEPS, (int)ceil(fabs(curvature) * length / MAX_STEP_TURN));
+  double step  = length / steps;
+
+  for (int i = 0; i <= steps; i++)
+  {
+    // point on the arc after travelling i steps, starting along the x axis
+    double travelled = i * step,
+           turned    = curvature * travelled,
+           x         = fabs(curvature) < 1e-9 ? travelled : sin(turned) / curvature,
+           y         = fabs(curvature) < 1e-9 ? 0        : (1.0 - cos(turned)) / curvature;
+
+    for (int j = 0; j < (int)obstacleX.size(); j++)
+    {
+      double dx = obstacleX[j] - x,
+             dy = obstacleY[j] - y;
+      if (dx * dx + dy * dy <= radiusSqr) return travelled;
+    }
+  }
+
+  return rollout;
+}
+
+/**
+ * Picks the best velocity pair the robot can reach by the next tick
+ *
+ * @param velocity            - current forward velocity in m/s
+ * @param angularVelocity     - current angular velocity in rad/s
+ * @param goal                - point to head towards, in the robot's frame
+ * @param dt                  - time until the next tick in seconds
+ * @param bestVelocity        - set to the forward velocity to send
+ * @param bestAngularVelocity - set to the angular velocity to send
+ * @return true if any pair was safe. False leaves the robot to turn in place
+ */
+bool DynamicWindowPlanner::getCommand(double velocity,
+                                      double angularVelocity,
+                                      Vector2 goal,
+                                      double dt,
+                                      double& bestVelocity,
+                                      double& bestAngularVelocity)
+{
+  // every pair reachable by the next tick
+  double minV = std::max(0.0,                 velocity        - maxAcceleration        * dt),
+         maxV = std::min(maxVelocity,         velocity        + maxAcceleration        * dt),
+         minW = std::max(-maxAngularVelocity, angularVelocity - maxAngularAcceleration * dt),
+         maxW = std::min(maxAngularVelocity,  angularVelocity + maxAngularAcceleration * dt);
+
+  double bestScore = -1;
+  sampleCount = 0;
+
+  for (int i = 0; i < VELOCITY_SAMPLES; i++)
+  {
+    double v = minV + (maxV - minV) * i / (VELOCITY_SAMPLES - 1);
+
+    for (int j = 0; j < ANGULAR_SAMPLES; j++)
+    {
+      double w = minW + (maxW - minW) * j / (ANGULAR_SAMPLES - 1);
+      sampleCount++;
+
+      // throw out pairs that cannot brake before the obstacle they run into
+      double freeDistance = getFreeDistance(v, w);
+      if (v * v > 2.0 * maxAcceleration * freeDistance) continue;
+
+      // heading towards the goal from where the arc leaves the robot a little way ahead
+      double yaw = w * HEADING_TIME, x, y;
+      if (fabs(w) < 1e-6)
+      {
+        x = v * HEADING_TIME;
+        y = 0;
+      }
+      else
+      {
+        x = v / w * sin(yaw);
+        y = v / w * (1.0 - cos(yaw));
+      }
+
+      double error = atan2(goal.y - y, goal.x - x) - yaw;
+      error = fabs(atan2(sin(error), cos(error)));
+
+      double score = HEADING_WEIGHT   * (1.0 - error / M_PI) +
+                     CLEARANCE_WEIGHT * freeDistance / (maxVelocity * PREDICT_TIME) +
+                     VELOCITY_WEIGHT  * (maxVelocity > 0 ? v / maxVelocity : 0);
+
+      if (score > bestScore)
+      {
+        bestScore           = score;
+        bestVelocity        = v;
+        bestAngularVelocity = w;
+      }
+    }
+  }
+
+  return bestScore >= 0;
+}
+
+/** @return number of velocity pairs scored by the last call to getCommand() */
+int DynamicWindowPlanner::getSampleCount() const
+{
+  return sampleCount;
+}
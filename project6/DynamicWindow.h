@@ -0,0 +1,58 @@
+#ifndef DYNAMIC_WINDOW_H
+#define DYNAMIC_WINDOW_H
+#pragma once
+
+#include <vector>
+#include "Vector2.h"
+
+/**
+ * Dynamic Window Approach local planner. Each tick it samples forward and
+ * angular velocity pairs the robot can reach before the next tick, rolls each
+ * one out along its arc against every point of the latest laser scan, and
+ * picks the pair that best trades off heading towards the goal, how far the arc
+ * stays clear of obstacles and speed. Pairs that could not stop before hitting
+ * something are thrown out.
+ *
+ * Everything is worked out in the robot's frame: x is straight ahead and y is
+ * to the left, so the scan never has to be moved into the world.
+ */
+class DynamicWindowPlanner
+{
+  double maxVelocity,            // m/s
+         maxAngularVelocity,     // rad/s
+         maxAcceleration,        // m/s^2
+         maxAngularAcceleration, // rad/s^2
+         robotRadius;            // m
+
+  // end points of the beams that hit something, in the robot's frame
+  std::vector<double> obstacleX,
+                      obstacleY;
+
+  int sampleCount; // number of pairs scored by the last call to getCommand()
+
+  double getFreeDistance(double velocity, double angularVelocity) const;
+
+public:
+  // constructor
+  DynamicWindowPlanner(double maxVelocity,
+                       double maxAngularVelocity,
+                       double maxAcceleration,
+                       double maxAngularAcceleration,
+                       double robotRadius = 0.2);
+
+  // inputs
+  void setScan(const std::vector<double>& ranges,
+               const std::vector<double>& bearings,
+               double maxRange);
+
+  // planning
+  bool getCommand(double velocity,
+                  double angularVelocity,
+                  Vector2 goal,
+                  double dt,
+                  double& bestVelocity,
+                  double& bestAngularVelocity);
+  int getSampleCount() const;
+};
+
+#endif
@@ -0,0 +1,246 @@
+#include "FrontierMap.h"
+#include <climits> // INT_MAX
+#include <cmath>   // cos, sin
+#include <fstream>
+
+/**
+ * Creates a new map where every cell is unknown
+ *
+ * @param width    - number of cells in a single row
+ * @param height   - number of cells in a single column
+ * @param cellSize - length of one side of a cell in meters
+ */
+FrontierMap::FrontierMap(int width, int height, double cellSize) :
+  GridBase<FrontierMap>(cellSize),
+  width(width),
+  height(height),
+  cells(width * height, CellState::Unknown),
+  frontierSlot(width * height, -1) {}
+
+/**
+ * Changes the state of a cell and remembers it for the next frontier update
+ *
+ * @param index - index of the cell to change
+ * @param state - the new state of the cell
+ */
+void FrontierMap::setCellState(int index, CellState::Enum state)
+{
+  if (cells[index] == state) return;
+
+  cells[index] = state;
+  changedCells.push_back(index);
+}
+
+/**
+ * @param index - index of the cell to check
+ * @return true if the cell is free and has an unknown neighbor
+ */
+bool FrontierMap::isFrontierCell(int index) const
+{
+  if (cells[index] != CellState::Free) return false;
+
+  int col = index % width,
+      row = index / width;
+
+  return (row > 0          && cells[index - width] == CellState::Unknown) ||
+         (col < width - 1  && cells[index + 1]     == CellState::Unknown) ||
+         (row < height - 1 && cells[index + width] == CellState::Unknown) ||
+         (col > 0          && cells[index - 1]     == CellState::Unknown);
+}
+
+/**
+ * Adds a cell to the list of frontiers if it is not already in it
+ *
+ * @param index - index of the cell to add
+ */
+void FrontierMap::addFrontier(int index)
+{
+  if (frontierSlot[index] >= 0) return;
+
+  frontierSlot[index] = frontiers.size();
+  frontiers.push_back(index);
+}
+
+/**
+ * Removes a cell from the list of frontiers by swapping the last frontier into its place
+ *
+ * @param index - index of the cell to remove
+ */
+void FrontierMap::removeFrontier(int index)
+{
+  int slot = frontierSlot[index];
+  if (slot < 0) return;
+
+  frontiers[slot]               = frontiers.back();
+  frontierSlot[frontiers[slot]] = slot;
+  frontiers.pop_back();
+  frontierSlot[index] = -1;
+}
+
+/**
+ * Fills in the map from a single laser scan. Every cell a beam passes through is
+ * marked free and the cell a beam stops in is marked occupied, unless the beam
+ * ran out at its maximum range without hitting anything.
+ *
+ * @param pos      - position of the robot in meters
+ * @param yaw      - yaw rotation of the robot in radians
+ * @param ranges   - distance measured by each beam in meters
+ * @param bearings - angle of each beam relative to the robot in radians
+ * @param maxRange - maximum range of the laser in meters
+ */
+void FrontierMap::integrateScan(Vector2 pos,
+                                double yaw,
+                                const std::vector<double>& ranges,
+                                const std::vector<double>& bearings,
+                                double maxRange)
+{
+  // step half a cell at a time so no cell along a beam is skipped over
+  double step = getCellSize() / 2.0;
+
+  // the robot is sitting in its own cell so it must be free
+  int robotCell = worldToIndex(pos);
+  if (robotCell >= 0) setCellState(robotCell, CellState::Free);
+
+  for (int i = 0; i < (int)ranges.size(); i++)
+  {
+    double angle = yaw + bearings[i],
+           range = ranges[i] < maxRange ? ranges[i] : maxRange;
+    Vector2 dir(cos(angle), sin(angle));
+
+    // clear out every cell up to where the beam stopped
+    int lastCell = robotCell;
+    for (double d = step; d < range; d += step)
+    {
+      int cell = worldToIndex(Vector2(pos.x + dir.x * d, pos.y + dir.y * d));
+      if (cell < 0) break;
+      if (cell == lastCell) continue;
+
+      // a wall seen by an earlier beam stays a wall
+      if (cells[cell] == CellState::Unknown) setCellState(cell, CellState::Free);
+      lastCell = cell;
+    }
+
+    // the beam hit something
+    if (ranges[i] < maxRange)
+    {
+      int hit = worldToIndex(Vector2(pos.x + dir.x * range, pos.y + dir.y * range));
+      if (hit >= 0 && hit != robotCell) setCellState(hit, CellState::Occupied);
+    }
+  }
+}
+
+/**
+ * @param index - index of the cell to check
+ * @return what is known about the cell
+ */
+CellState::Enum FrontierMap::getCellState(int index) const
+{
+  return (CellState::Enum)cells[index];
+}
+
+/**
+ * Writes the map out in the same format as map.txt. Cells that were never seen
+ * are written as occupied so the planner never routes through them.
+ *
+ * @param mapFileName - name of the file to write the map to
+ * @return true if the file could be opened
+ */
+bool FrontierMap::writeMap(const std::string& mapFileName) const
+{
+  std::ofstream mapFile(mapFileName.c_str());
+  if (!mapFile.is_open()) return false;
+
+  for (int i = 0; i < getCellCount(); i++)
+  {
+    if (i % width == 0 && i != 0) mapFile << "\n";
+    mapFile << (cells[i] == CellState::Free ? 0 : 1) << " ";
+  }
+
+  return true;
+}
+
+/**
+ * Brings the list of frontiers up to date. Only the cells that changed since the
+ * last update and their neighbors can have become or stopped being frontiers.
+ */
+void FrontierMap::updateFrontiers()
+{
+  for (int i = 0; i < (int)changedCells.size(); i++)
+  {
+    int index = changedCells[i],
+        col   = index % width,
+        row   = index / width;
+
+    // the changed cell itself, followed by its top, right, bottom, and left neighbors
+    int toCheck[5] = { index,
+                       row > 0          ? index - width : -1,
+                       col < width - 1  ? index + 1     : -1,
+                       row < height - 1 ? index + width : -1,
+                       col > 0          ? index - 1     : -1 };
+
+    for (int j = 0; j < 5; j++)
+    {
+      if (toCheck[j] < 0) continue;
+
+      if (isFrontierCell(toCheck[j])) addFrontier(toCheck[j]);
+      else                            removeFrontier(toCheck[j]);
+    }
+  }
+
+  changedCells.clear();
+}
+
+/**
+ * Gives up on a frontier the laser cannot see past by marking its unknown
+ * neighbors as occupied
+ *
+ * @param index - index of the frontier cell
+ */
+void FrontierMap::closeFrontier(int index)
+{
+  int col = index % width,
+      row = index / width;
+
+  if (row > 0          && cells[index - width] == CellState::Unknown) setCellState(index - width, CellState::Occupied);
+  if (col < width - 1  && cells[index + 1]     == CellState::Unknown) setCellState(index + 1,     CellState::Occupied);
+  if (row < height - 1 && cells[index + width] == CellState::Unknown) setCellState(index + width, CellState::Occupied);
+  if (col > 0          && cells[index - 1]     == CellState::Unknown) setCellState(index - 1,     CellState::Occupied);
+
+  updateFrontiers();
+}
+
+/**
+ * @param index - index of the cell to check
+ * @return true if the cell was a frontier as of the last call to updateFrontiers()
+ */
+bool FrontierMap::isFrontier(int index) const
+{
+  return frontierSlot[index] >= 0;
+}
+
+/** @return every frontier cell as of the last call to updateFrontiers() */
+const std::vector<int>& FrontierMap::getFrontiers() const
+{
+  return frontiers;
+}
+
+/**
+ * Finds the frontier that takes the fewest cells to reach
+ *
+ * @param costs - cost of reaching each cell from the robot, such as from
+ *                GridPlanner::getWavefrontCosts()
+ * @return index of the nearest reachable frontier or -1 if there are none
+ */
+int FrontierMap::getNearestFrontier(const std::vector<int>& costs) const
+{
+  int nearest = -1;
+
+  for (int i = 0; i < (int)frontiers.size(); i++)
+  {
+    int cost = costs[frontiers[i]];
+    if (cost == INT_MAX) continue;
+    if (nearest < 0 || cost < costs[nearest]) nearest = frontiers[i];
+  }
+
+  return nearest;
+}
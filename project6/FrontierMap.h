@@ -0,0 +1,71 @@
+#ifndef FRONTIER_MAP_H
+#define FRONTIER_MAP_H
+#pragma once
+
+#include <string>
+#include <vector>
+#include "Grid.h"
+#include "Vector2.h"
+
+/**
+ * What the robot knows about a single cell. Free and Occupied line up with the
+ * 0s and 1s of map.txt so the map can be planned over like any other grid, with
+ * unknown cells treated as occupied.
+ */
+namespace CellState
+{
+  enum Enum { Free = 0, Occupied = 1, Unknown = 2 };
+}
+
+/**
+ * Occupancy grid that starts out completely unknown and is filled in from laser
+ * scans as the robot explores.
+ *
+ * A frontier is a free cell next to an unknown one. Frontiers are tracked
+ * incrementally: each scan records the cells whose state changed and only those
+ * cells and their neighbors are checked again, so the cost of a scan does not
+ * grow with the size of the map.
+ */
+class FrontierMap : public GridBase<FrontierMap>
+{
+  int width,                      // number of cells in a single row
+      height;                     // number of cells in a single column
+  std::vector<char> cells;        // CellState of every cell
+  std::vector<int>  changedCells; // cells whose state changed since the last frontier update
+  std::vector<int>  frontiers;    // every frontier cell, in no particular order
+  std::vector<int>  frontierSlot; // position of each cell in frontiers, or -1
+
+  void setCellState(int index, CellState::Enum state);
+  bool isFrontierCell(int index) const;
+  void addFrontier(int index);
+  void removeFrontier(int index);
+
+public:
+  // constructor
+  FrontierMap(int width, int height, double cellSize = 0.5);
+
+  // dimensions needed by GridBase
+  int getWidth()  const { return width; }
+  int getHeight() const { return height; }
+
+  const char* getCells() const { return &cells[0]; }
+  char*       getCells()       { return &cells[0]; }
+
+  // mapping
+  void integrateScan(Vector2 pos,
+                     double yaw,
+                     const std::vector<double>& ranges,
+                     const std::vector<double>& bearings,
+                     double maxRange);
+  CellState::Enum getCellState(int index) const;
+  bool writeMap(const std::string& mapFileName) const;
+
+  // frontiers
+  void updateFrontiers();
+  void closeFrontier(int index);
+  bool isFrontier(int index) const;
+  const std::vector<int>& getFrontiers() const;
+  int getNearestFrontier(const std::vector<int>& costs) const;
+};
+
+#endif
@@ -0,0 +1,303 @@
+#ifndef GRID_H
+#define GRID_H
+#pragma once
+
+#include <cmath>    // floor
+#include <cstdlib>  // abs
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Vector2.h"
+
+// pass as both dimensions of a Grid to have its size decided at runtime
+const int DYNAMIC_SIZE = 0;
+
+/**
+ * Directions between adjacent cells, in the same order getNeighbors() checks them
+ */
+namespace GridDirection
+{
+  enum Enum { Top, Right, Bottom, Left, Count };
+}
+
+/**
+ * Everything shared between fixed and dynamically sized occupancy grids.
+ *
+ * Cells are stored row by row with the first row of the file at index 0,
+ * the same layout Graph.java uses. Each cell is cellSize meters across and
+ * the grid is centered on the world origin.
+ *
+ * The concrete grid supplies getWidth(), getHeight() and getCells(). When
+ * those are constexpr, every bit of index math below folds into constants.
+ */
+template <class Derived>
+class GridBase
+{
+  double cellSize; // length of one side of a cell in meters
+
+  const Derived& self() const { return static_cast<const Derived&>(*this); }
+  Derived&       self()       { return static_cast<Derived&>(*this); }
+
+protected:
+  GridBase(double cellSize) : cellSize(cellSize) {}
+
+public:
+  // map io
+  bool readMap(const std::string& mapFileName);
+  void printMap() const;
+
+  // grows every occupied cell by one cell to account for the robot's size
+  void dilate();
+
+  // dimensions
+  int    getCellCount() const { return self().getWidth() * self().getHeight(); }
+  double getCellSize()  const { return cellSize; }
+
+  // cell queries
+  bool isOccupied(int index) const { return self().getCells()[index]; }
+  int  getNeighbors(int index, int neighbors[4]) const;
+  int  getNeighbor(int index, GridDirection::Enum dir) const;
+  int  getManhattanDistance(int from, int to) const;
+
+  // conversions between world coordinates and cells
+  int     worldToIndex(Vector2 pos) const;
+  Vector2 indexToWorld(int index) const;
+  Vector2 getCellCenter(int index) const;
+};
+
+/**
+ * Occupancy grid whose size is known at compile time. The cells live inside the
+ * object itself so a 32x32 map takes up a single kilobyte.
+ */
+template <int W, int H>
+class Grid : public GridBase<Grid<W, H> >
+{
+  char occupancy[W * H]; // 1 if the cell is occupied, 0 otherwise
+
+public:
+  Grid(double cellSize = 0.5) : GridBase<Grid<W, H> >(cellSize), occupancy() {}
+
+  static constexpr int getWidth()  { return W; }
+  static constexpr int getHeight() { return H; }
+
+  const char* getCells() const { return occupancy; }
+  char*       getCells()       { return occupancy; }
+};
+
+/**
+ * Fallback occupancy grid for maps whose size is only known at runtime
+ */
+template <>
+class Grid<DYNAMIC_SIZE, DYNAMIC_SIZE> : public GridBase<Grid<DYNAMIC_SIZE, DYNAMIC_SIZE> >
+{
+  int width,                   // number of cells in a single row
+      height;                  // number of cells in a single column
+  std::vector<char> occupancy; // 1 if the cell is occupied, 0 otherwise
+
+public:
+  Grid(int width, int height, double cellSize = 0.5) :
+    GridBase<Grid<DYNAMIC_SIZE, DYNAMIC_SIZE> >(cellSize),
+    width(width),
+    height(height),
+    occupancy(width * height, 0) {}
+
+  int getWidth()  const { return width; }
+  int getHeight() const { return height; }
+
+  const char* getCells() const { return &occupancy[0]; }
+  char*       getCells()       { return &occupancy[0]; }
+};
+
+typedef Grid<DYNAMIC_SIZE, DYNAMIC_SIZE> DynamicGrid;
+
+/**
+ * Reads in the occupancy grid from a file of 0s and 1s. The first row of the
+ * file is the top of the map.
+ *
+ * @param mapFileName - name of the file to read the map from
+ * @return true if every cell was read in. False otherwise
+ */
+template <class Derived>
+bool GridBase<Derived>::readMap(const std::string& mapFileName)
+{
+  std::ifstream mapFile(mapFileName.c_str());
+  if (!mapFile.is_open()) return false;
+
+  char *cells = self().getCells();
+  int cell;
+  for (int i = 0; i < getCellCount(); i++)
+  {
+    if (!(mapFile >> cell)) return false;
+    cells[i] = cell == 1;
+  }
+
+  return true;
+}
+
+/** Prints the grid to the console in the same layout as map.txt */
+template <class Derived>
+void GridBase<Derived>::printMap() const
+{
+  for (int i = 0; i < getCellCount(); i++)
+  {
+    if (i % self().getWidth() == 0 && i != 0) std::cout << "\n";
+    std::cout << (int)isOccupied(i) << " ";
+  }
+  std::cout << "\n";
+}
+
+/**
+ * Dilates all occupied cells similar to minesweeper.
+ *
+ * 0 0 0    1 1 1
+ * 0 1 0 -> 1 1 1
+ * 0 0 0    1 1 1
+ */
+template <class Derived>
+void GridBase<Derived>::dilate()
+{
+  const int width  = self().getWidth(),
+            height = self().getHeight();
+
+  char *cells = self().getCells();
+  std::vector<char> original(cells, cells + getCellCount());
+
+  for (int row = 0; row < height; row++)
+  {
+    for (int col = 0; col < width; col++)
+    {
+      if (!original[col + width * row]) continue;
+
+      // occupy every cell surrounding the occupied one
+      for (int r = row - 1; r <= row + 1; r++)
+      {
+        for (int c = col - 1; c <= col + 1; c++)
+        {
+          if (r < 0 || r >= height || c < 0 || c >= width) continue;
+          cells[c + width * r] = 1;
+        }
+      }
+    }
+  }
+}
+
+/**
+ * Finds the unoccupied cells adjacent to the given one (top, right, bottom, and left).
+ *
+ * @param index     - index of the cell whose neighbors we want
+ * @param neighbors - filled in with the indices of the unoccupied neighbors
+ * @return the number of neighbors written to the neighbors array
+ */
+template <class Derived>
+int GridBase<Derived>::getNeighbors(int index, int neighbors[4]) const
+{
+  const int width  = self().getWidth(),
+            height = self().getHeight();
+
+  const char *cells = self().getCells();
+  int col   = index % width,
+      row   = index / width,
+      count = 0;
+
+  if (row > 0          && !cells[index - width]) neighbors[count++] = index - width; // top
+  if (col < width - 1  && !cells[index + 1])     neighbors[count++] = index + 1;     // right
+  if (row < height - 1 && !cells[index + width]) neighbors[count++] = index + width; // bottom
+  if (col > 0          && !cells[index - 1])     neighbors[count++] = index - 1;     // left
+
+  return count;
+}
+
+/**
+ * Finds the cell next to the given one in a single direction
+ *
+ * @param index - index of the cell to step from
+ * @param dir   - direction to step in
+ * @return index of the neighbor or -1 if it is off the grid or occupied
+ */
+template <class Derived>
+int GridBase<Derived>::getNeighbor(int index, GridDirection::Enum dir) const
+{
+  const int width  = self().getWidth(),
+            height = self().getHeight();
+
+  int col  = index % width,
+      row  = index / width,
+      next = -1;
+
+  switch (dir)
+  {
+    case GridDirection::Top:    if (row > 0)          next = index - width; break;
+    case GridDirection::Right:  if (col < width - 1)  next = index + 1;     break;
+    case GridDirection::Bottom: if (row < height - 1) next = index + width; break;
+    case GridDirection::Left:   if (col > 0)          next = index - 1;     break;
+    default: break;
+  }
+
+  return next < 0 || isOccupied(next) ? -1 : next;
+}
+
+/**
+ * @return number of cells between the two given cells when only moving
+ *         horizontally and vertically
+ */
+template <class Derived>
+int GridBase<Derived>::getManhattanDistance(int from, int to) const
+{
+  const int width = self().getWidth();
+
+  return abs(from % width - to % width) + abs(from / width - to / width);
+}
+
+/**
+ * Converts a four quadrant world coordinate to the index of the cell it falls in.
+ * This is the C++ equivalent of convertToSingleQuad() in Graph.java.
+ *
+ * @param pos - position in meters
+ * @return index of the cell or -1 if the position is off of the grid
+ */
+template <class Derived>
+int GridBase<Derived>::worldToIndex(Vector2 pos) const
+{
+  const int width  = self().getWidth(),
+            height = self().getHeight();
+
+  int col = (int)floor(pos.x / cellSize + width  / 2.0),
+      row = (int)floor(height - (pos.y / cellSize + height / 2.0));
+
+  if (col < 0 || col >= width || row < 0 || row >= height) return -1;
+
+  return col + width * row;
+}
+
+/**
+ * Converts the index of a cell back to its four quadrant world coordinate
+ *
+ * @param index - index of the cell
+ * @return position of the cell in meters
+ */
+template <class Derived>
+Vector2 GridBase<Derived>::indexToWorld(int index) const
+{
+  const int width  = self().getWidth(),
+            height = self().getHeight();
+
+  return Vector2((index % width)  * cellSize - width  * cellSize / 2.0,
+                 height * cellSize / 2.0 - (index / width) * cellSize);
+}
+
+/**
+ * Finds the middle of a cell. indexToWorld() gives the top left corner instead.
+ *
+ * @param index - index of the cell
+ * @return position of the middle of the cell in meters
+ */
+template <class Derived>
+Vector2 GridBase<Derived>::getCellCenter(int index) const
+{
+  Vector2 corner = indexToWorld(index);
+
+  return Vector2(corner.x + cellSize / 2.0, corner.y - cellSize / 2.0);
+}
+
+#endif
@@ -0,0 +1,441 @@
+#ifndef GRID_PLANNER_H
+#define GRID_PLANNER_H
+#pragma once
+
+#include <algorithm> // std::max, std::min, std::reverse
+#include <climits>   // INT_MAX
+#include <cstdio>    // printf
+#include <cstdlib>   // abs
+#include <queue>
+#include <stdint.h>  // uint16_t
+#include <vector>
+#include "Grid.h"
+#include "Vector2.h"
+
+/**
+ * The heuristic the planner should use to estimate the remaining cost to the goal
+ */
+namespace HeuristicMethod
+{
+  enum Enum { Manhattan, Landmarks };
+}
+
+/**
+ * ALT (A*, landmarks, triangle inequality) heuristic.
+ *
+ * Exact distance fields are computed from a handful of well spread landmarks
+ * when the map is loaded. For any landmark L, |d(L, goal) - d(L, n)| never
+ * overestimates d(n, goal), so the largest such difference is an admissible
+ * heuristic that follows the walls of the map rather than ignoring them.
+ */
+template <class GridType>
+class LandmarkHeuristic
+{
+  const GridType& grid;
+  std::vector<int>      landmarks; // cell indices of the chosen landmarks
+  std::vector<uint16_t> distances; // distances[cell * landmarkCount + landmark], in cells
+
+  void computeDistanceField(int source, std::vector<uint16_t>& field) const;
+  void chooseLandmarks(int landmarkCount);
+
+public:
+  // marks cells a landmark cannot reach
+  static const uint16_t UNREACHABLE = 0xFFFF;
+
+  // constructor
+  LandmarkHeuristic(const GridType& grid, int landmarkCount = 8);
+
+  // estimate the number of cells between two cells
+  int estimate(int from, int to) const;
+
+  // landmarks that were chosen
+  const std::vector<int>& getLandmarks() const;
+};
+
+/**
+ * A* planner over the 4-connected cells of an occupancy grid. The same code is
+ * used for fixed size grids, where the index math is resolved at compile time,
+ * and for DynamicGrid.
+ */
+template <class GridType>
+class GridPlanner
+{
+  const GridType& grid;
+  HeuristicMethod::Enum method;          // heuristic used when searching
+  LandmarkHeuristic<GridType> landmarks; // only populated when using HeuristicMethod::Landmarks
+  int expandedCount;                     // number of cells expanded by the last search
+
+  // search scratch space, reused between searches
+  std::vector<int>  costSoFar,
+                    parent;
+  std::vector<char> isClosed;
+
+public:
+  // constructor
+  GridPlanner(const GridType& grid,
+              HeuristicMethod::Enum method = HeuristicMethod::Landmarks,
+              int landmarkCount            = 8);
+
+  // estimate of the number of cells between two cells
+  int getHeuristic(int from, int to) const;
+
+  // searching
+  bool findPath(int startIndex, int goalIndex, std::vector<int>& path);
+  std::vector<Vector2> getWaypoints(Vector2 start, Vector2 goal);
+  void getWavefrontCosts(int startIndex, std::vector<int>& costs);
+
+  // statistics
+  int getExpandedCount() const;
+};
+
+/**
+ * Cell waiting to be expanded by A*. Ordered so that the lowest estimated total
+ * cost comes out of the priority queue first, preferring cells closer to the goal
+ * when there is a tie.
+ */
+struct OpenCell
+{
+  int estimate, // cost so far plus heuristic
+      cost,     // cost so far
+      index;    // index of the cell in the grid
+
+  OpenCell(int estimate, int cost, int index) : estimate(estimate), cost(cost), index(index) {}
+
+  bool operator<(OpenCell const& other) const
+  {
+    if (estimate != other.estimate) return estimate > other.estimate;
+    return cost < other.cost;
+  }
+};
+
+// definition for the in-class constant since it is bound to references
+template <class GridType>
+const uint16_t LandmarkHeuristic<GridType>::UNREACHABLE;
+
+/**
+ * Picks landmarks and precomputes their distance fields
+ *
+ * @param grid          - the (already dilated) grid we are planning over
+ * @param landmarkCount - number of landmarks to place. 0 disables the heuristic
+ */
+template <class GridType>
+LandmarkHeuristic<GridType>::LandmarkHeuristic(const GridType& grid, int landmarkCount) :
+  grid(grid)
+{
+  if (landmarkCount > 0) chooseLandmarks(landmarkCount);
+}
+
+/**
+ * Breadth first search outwards from the source cell. Since every move costs
+ * one cell, this gives the exact distance from the source to every other cell.
+ *
+ * @param source - index of the cell to measure from
+ * @param field  - filled in with the distance to every cell, or UNREACHABLE
+ */
+template <class GridType>
+void LandmarkHeuristic<GridType>::computeDistanceField(int source, std::vector<uint16_t>& field) const
+{
+  field.assign(grid.getCellCount(), UNREACHABLE);
+
+  std::vector<int> queue;
+  queue.reserve(grid.getCellCount());
+
+  field[source] = 0;
+  queue.push_back(source);
+
+  int neighbors[4];
+  for (int front = 0; front < (int)queue.size(); front++)
+  {
+    int cur   = queue[front];
+    int count = grid.getNeighbors(cur, neighbors);
+
+    for (int i = 0; i < count; i++)
+    {
+      if (field[neighbors[i]] != UNREACHABLE) continue;
+
+      field[neighbors[i]] = field[cur] + 1;
+      queue.push_back(neighbors[i]);
+    }
+  }
+}
+
+/**
+ * Spreads landmarks out with farthest point selection. The first landmark is
+ * the cell farthest from an arbitrary free cell and each one after that is the
+ * cell farthest from all of the landmarks picked so far. Landmarks on the edge
+ * of the map give the tightest bounds.
+ *
+ * @param landmarkCount - number of landmarks to place
+ */
+template <class GridType>
+void LandmarkHeuristic<GridType>::chooseLandmarks(int landmarkCount)
+{
+  int cellCount = grid.getCellCount();
+
+  // find a free cell to start from
+  int seed = 0;
+  while (seed < cellCount && grid.isOccupied(seed)) seed++;
+  if (seed == cellCount) return;
+
+  // closest distance from each cell to any chosen landmark
+  std::vector<uint16_t> field, closest;
+  computeDistanceField(seed, closest);
+
+  distances.assign(cellCount * landmarkCount, UNREACHABLE);
+
+  for (int l = 0; l < landmarkCount; l++)
+  {
+    // pick the reachable cell farthest from every landmark so far
+    int next = -1;
+    for (int i = 0; i < cellCount; i++)
+    {
+      if (closest[i] == UNREACHABLE || closest[i] == 0) continue;
+      if (next < 0 || closest[i] > closest[next]) next = i;
+    }
+
+    // no cells left that would add any information
+    if (next < 0) break;
+
+    landmarks.push_back(next);
+    computeDistanceField(next, field);
+
+    // store the field and pull in the closest distances
+    for (int i = 0; i < cellCount; i++)
+    {
+      distances[i * landmarkCount + l] = field[i];
+      closest[i] = std::min(closest[i], field[i]);
+    }
+  }
+
+  // shrink the table if fewer landmarks could be placed than were asked for
+  if ((int)landmarks.size() < landmarkCount)
+  {
+    int placed = landmarks.size();
+    for (int i = 0; i < cellCount; i++)
+    {
+      for (int l = 0; l < placed; l++)
+      {
+        distances[i * placed + l] = distances[i * landmarkCount + l];
+      }
+    }
+    distances.resize(cellCount * placed);
+  }
+}
+
+/**
+ * Lower bound on the number of cells between two cells using the triangle inequality
+ *
+ * @param from - index of the cell we are estimating from
+ * @param to   - index of the cell we are estimating to
+ * @return estimated distance in cells. Never more than the real distance
+ */
+template <class GridType>
+int LandmarkHeuristic<GridType>::estimate(int from, int to) const
+{
+  int count = landmarks.size();
+  if (count == 0) return 0;
+
+  const uint16_t *fromDist = &distances[0] + from * count,
+                 *toDist   = &distances[0] + to   * count;
+
+  int best = 0;
+  for (int l = 0; l < count; l++)
+  {
+    // skip landmarks that cannot see both cells
+    if (fromDist[l] == UNREACHABLE || toDist[l] == UNREACHABLE) continue;
+
+    best = std::max(best, abs((int)fromDist[l] - (int)toDist[l]));
+  }
+
+  return best;
+}
+
+/** @return cell indices of the chosen landmarks */
+template <class GridType>
+const std::vector<int>& LandmarkHeuristic<GridType>::getLandmarks() const
+{
+  return landmarks;
+}
+
+/**
+ * Creates a new planner for the given grid. Landmarks are placed right away so
+ * the grid should already be dilated.
+ *
+ * @param grid          - the grid to plan over
+ * @param method        - heuristic to guide the search with
+ * @param landmarkCount - number of landmarks to use with HeuristicMethod::Landmarks
+ */
+template <class GridType>
+GridPlanner<GridType>::GridPlanner(const GridType& grid, HeuristicMethod::Enum method, int landmarkCount) :
+  grid(grid),
+  method(method),
+  landmarks(grid, method == HeuristicMethod::Landmarks ? landmarkCount : 0),
+  expandedCount(0),
+  costSoFar(grid.getCellCount()),
+  parent(grid.getCellCount()),
+  isClosed(grid.getCellCount()) {}
+
+/**
+ * Estimate the number of cells between two cells. Landmarks can still lose to
+ * the Manhattan distance in open areas so the larger of the two is used.
+ *
+ * @param from - index of the cell we are estimating from
+ * @param to   - index of the cell we are estimating to
+ * @return estimated distance in cells
+ */
+template <class GridType>
+int GridPlanner<GridType>::getHeuristic(int from, int to) const
+{
+  int manhattan = grid.getManhattanDistance(from, to);
+
+  if (method == HeuristicMethod::Manhattan) return manhattan;
+
+  return std::max(manhattan, landmarks.estimate(from, to));
+}
+
+/**
+ * Finds the shortest path between two cells with A*
+ *
+ * @param startIndex - index of the cell to start from
+ * @param goalIndex  - index of the cell to reach
+ * @param path       - filled in with every cell from the start to the goal
+ * @return true if a path could be found. False otherwise
+ */
+template <class GridType>
+bool GridPlanner<GridType>::findPath(int startIndex, int goalIndex, std::vector<int>& path)
+{
+  path.clear();
+  expandedCount = 0;
+
+  if (startIndex < 0 || goalIndex < 0 ||
+      grid.isOccupied(startIndex) || grid.isOccupied(goalIndex)) return false;
+
+  std::fill(costSoFar.begin(), costSoFar.end(), INT_MAX);
+  std::fill(isClosed.begin(),  isClosed.end(),  0);
+
+  std::priority_queue<OpenCell> open;
+  costSoFar[startIndex] = 0;
+  parent[startIndex]    = -1;
+  open.push(OpenCell(getHeuristic(startIndex, goalIndex), 0, startIndex));
+
+  int neighbors[4];
+  while (!open.empty())
+  {
+    OpenCell front = open.top();
+    open.pop();
+
+    // skip stale entries for cells that were already expanded
+    if (isClosed[front.index]) continue;
+    isClosed[front.index] = 1;
+    expandedCount++;
+
+    // reached the goal, unwind the path
+    if (front.index == goalIndex)
+    {
+      for (int cur = goalIndex; cur != -1; cur = parent[cur]) path.push_back(cur);
+      std::reverse(path.begin(), path.end());
+      return true;
+    }
+
+    int count = grid.getNeighbors(front.index, neighbors);
+    for (int i = 0; i < count; i++)
+    {
+      int next = neighbors[i],
+          cost = front.cost + 1;
+
+      if (isClosed[next] || cost >= costSoFar[next]) continue;
+
+      costSoFar[next] = cost;
+      parent[next]    = front.index;
+      open.push(OpenCell(cost + getHeuristic(next, goalIndex), cost, next));
+    }
+  }
+
+  return false;
+}
+
+/**
+ * Obtains the waypoints between 2 points. Like the wavefront planner in
+ * Graph.java, a waypoint is only placed where the path changes direction.
+ *
+ * @param start - coord of the starting location
+ * @param goal  - coord of the end location
+ * @return waypoints for the robot to follow. Empty if there is no path
+ */
+template <class GridType>
+std::vector<Vector2> GridPlanner<GridType>::getWaypoints(Vector2 start, Vector2 goal)
+{
+  std::vector<Vector2> waypoints;
+  std::vector<int>     path;
+
+  if (!findPath(grid.worldToIndex(start), grid.worldToIndex(goal), path))
+  {
+    printf("ERROR! Cannot find path between points (%.1f, %.1f) and (%.1f %.1f).\n",
+           start.x, start.y, goal.x, goal.y);
+    return waypoints;
+  }
+
+  // add a waypoint whenever the direction of travel changes
+  int lastStep = 0;
+  for (int i = 0; i + 1 < (int)path.size(); i++)
+  {
+    int step = path[i + 1] - path[i];
+    if (step != lastStep)
+    {
+      lastStep = step;
+      waypoints.push_back(grid.indexToWorld(path[i]));
+    }
+  }
+
+  // add the final point
+  waypoints.push_back(grid.indexToWorld(path.back()));
+
+  return waypoints;
+}
+
+/**
+ * Spreads a wavefront out from the start cell, the same way markPathWavefront()
+ * does in Graph.java, to find the cost of the shortest path to every cell at once.
+ *
+ * @param startIndex - index of the cell to start from
+ * @param costs      - filled in with the number of cells to reach each cell, or
+ *                     INT_MAX if it cannot be reached
+ */
+template <class GridType>
+void GridPlanner<GridType>::getWavefrontCosts(int startIndex, std::vector<int>& costs)
+{
+  costs.assign(grid.getCellCount(), INT_MAX);
+  expandedCount = 0;
+
+  if (startIndex < 0 || grid.isOccupied(startIndex)) return;
+
+  // reuse the parent scratch space as the queue
+  int front = 0, back = 0;
+  costs[startIndex] = 0;
+  parent[back++]    = startIndex;
+
+  int neighbors[4];
+  while (front < back)
+  {
+    int cur   = parent[front++];
+    int count = grid.getNeighbors(cur, neighbors);
+    expandedCount++;
+
+    for (int i = 0; i < count; i++)
+    {
+      if (costs[neighbors[i]] != INT_MAX) continue;
+
+      costs[neighbors[i]] = costs[cur] + 1;
+      parent[back++]      = neighbors[i];
+    }
+  }
+}
+
+/** @return number of cells expanded by the last search */
+template <class GridType>
+int GridPlanner<GridType>::getExpandedCount() const
+{
+  return expandedCount;
+}
+
+#endif
@@ -0,0 +1,262 @@
+#include "LatencyHistogram.h"
+#include <csignal>  // signal, raise, SIGINT, SIGTERM
+#include <cstdio>   // fflush
+#include <cstdlib>  // atexit
+#include <unistd.h> // write
+
+// names of each stage when printed, in the same order as ProfileStage
+static const char* STAGE_NAMES[ProfileStage::Count] =
+{
+  "read", "localize", "decide", "command",
+  "followProfile", "rotateToFace", "autoPilotLaser", "handleBump"
+};
+
+// one histogram per stage
+static LatencyHistogram stageHistograms[ProfileStage::Count];
+
+/** Creates an empty histogram */
+LatencyHistogram::LatencyHistogram()
+{
+  reset();
+}
+
+/**
+ * @param ns - value to find the bucket of
+ * @return index of the bucket the value falls in
+ */
+int LatencyHistogram::getBucket(uint64_t ns)
+{
+  // small values each get a bucket of their own
+  if (ns < (uint64_t)SUB_BUCKETS) return (int)ns;
+
+  // keep the top SUB_BUCKET_BITS + 1 bits of the value
+  int topBit = 63 - __builtin_clzll(ns),
+      shift  = topBit - SUB_BUCKET_BITS;
+
+  return (shift + 1) * SUB_BUCKETS + (int)((ns >> shift) & (SUB_BUCKETS - 1));
+}
+
+/**
+ * @param bucket - index of a bucket
+ * @return the value in the middle of the bucket
+ */
+uint64_t LatencyHistogram::getBucketValue(int bucket)
+{
+  if (bucket < SUB_BUCKETS) return bucket;
+
+  int shift = bucket / SUB_BUCKETS - 1;
+  uint64_t low = (uint64_t)(SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+
+  return low + ((1ULL << shift) >> 1);
+}
+
+/**
+ * Adds a value to the histogram
+ *
+ * @param ns - latency in nanoseconds
+ */
+void LatencyHistogram::record(uint64_t ns)
+{
+  counts[getBucket(ns)]++;
+  count++;
+  if (ns > maxNs) maxNs = ns;
+}
+
+/** Removes every value from the histogram */
+void LatencyHistogram::reset()
+{
+  for (int i = 0; i < BUCKET_COUNT; i++) counts[i] = 0;
+  count = 0;
+  maxNs = 0;
+}
+
+/** @return number of values recorded */
+uint64_t LatencyHistogram::getCount() const
+{
+  return count;
+}
+
+/** @return largest value recorded in nanoseconds */
+uint64_t LatencyHistogram::getMax() const
+{
+  return maxNs;
+}
+
+/**
+ * @param percentile - percentage of values that should be at or below the result, e.g. 99
+ * @return the value at that percentile in nanoseconds, or 0 if nothing was recorded
+ */
+uint64_t LatencyHistogram::getPercentile(double percentile) const
+{
+  if (count == 0) return 0;
+
+  uint64_t wanted = (uint64_t)(percentile / 100.0 * count + 0.5),
+           seen   = 0;
+  if (wanted < 1) wanted = 1;
+
+  for (int i = 0; i < BUCKET_COUNT; i++)
+  {
+    seen += counts[i];
+    if (seen >= wanted) return getBucketValue(i) < maxNs ? getBucketValue(i) : maxNs;
+  }
+
+  return maxNs;
+}
+
+/** Records the time since construction into the stage's histogram */
+ScopedStageTimer::~ScopedStageTimer()
+{
+  std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - start;
+  stageHistograms[stage].record(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+}
+
+/**
+ * @param stage - the stage to get
+ * @return the histogram of every time recorded for the stage
+ */
+LatencyHistogram& getStageHistogram(ProfileStage::Enum stage)
+{
+  return stageHistograms[stage];
+}
+
+/**
+ * Writes text into a fixed width column of a line. Only plain loops are used
+ * so this is safe to call from a signal handler.
+ *
+ * @param line          - line being built
+ * @param length        - number of characters already in the line
+ * @param text          - text to write
+ * @param width         - width of the column, padded with spaces
+ * @param isLeftAligned - true to pad after the text instead of before it
+ * @return number of characters in the line afterwards
+ */
+static int appendColumn(char* line, int length, const char* text, int width, bool isLeftAligned)
+{
+  int textLength = 0;
+  while (text[textLength]) textLength++;
+
+  int padding = width > textLength ? width - textLength : 0;
+
+  if (!isLeftAligned) for (int i = 0; i < padding; i++) line[length++] = ' ';
+  for (int i = 0; i < textLength; i++) line[length++] = text[i];
+  if (isLeftAligned) for (int i = 0; i < padding; i++) line[length++] = ' ';
+
+  return length;
+}
+
+/**
+ * Formats a latency in microseconds with one decimal place using integer math
+ * only, as snprintf() is not safe to call from a signal handler.
+ *
+ * @param text       - filled in with the formatted value, at least 24 characters
+ * @param value      - latency in nanoseconds, or a plain number
+ * @param hasDecimal - false to print a plain number instead, e.g. for counts
+ */
+static void formatValue(char* text, uint64_t value, bool hasDecimal)
+{
+  char digits[24];
+  int  count = 0;
+
+  // tenths of a microsecond when printing a latency
+  if (hasDecimal) value /= 100;
+
+  do
+  {
+    digits[count++] = '0' + value % 10;
+    value /= 10;
+  }
+  while (value > 0 || (hasDecimal && count < 2));
+
+  int length = 0;
+  while (count > 0)
+  {
+    if (hasDecimal && count == 1) text[length++] = '.';
+    text[length++] = digits[--count];
+  }
+  text[length] = '\0';
+}
+
+/**
+ * Prints the p50, p99 and max latency of every stage that was timed. Values
+ * are formatted by hand and only write() is called, so this is safe to call
+ * from a signal handler while the program is being killed.
+ *
+ * @param fd - file descriptor to print to
+ */
+void printStageLatencies(int fd)
+{
+  const char* HEADERS[] = { "count", "p50", "p99", "max" };
+
+  char line[128], value[24];
+  int  length = 0;
+
+  line[length++] = '\n';
+  length = appendColumn(line, length, "stage (us)", 16, true);
+  for (int i = 0; i < 4; i++)
+  {
+    line[length++] = ' ';
+    length = appendColumn(line, length, HEADERS[i], 10, false);
+  }
+  line[length++] = '\n';
+  if (write(fd, line, length) < 0) return;
+
+  for (int i = 0; i < ProfileStage::Count; i++)
+  {
+    const LatencyHistogram& histogram = stageHistograms[i];
+    if (histogram.getCount() == 0) continue;
+
+    uint64_t values[] = { histogram.getCount(),
+                          histogram.getPercentile(50),
+                          histogram.getPercentile(99),
+                          histogram.getMax() };
+
+    length = appendColumn(line, 0, STAGE_NAMES[i], 16, true);
+    for (int j = 0; j < 4; j++)
+    {
+      // the count is a plain number, the rest are latencies
+      formatValue(value, values[j], j > 0);
+
+      line[length++] = ' ';
+      length = appendColumn(line, length, value, 10, false);
+    }
+    line[length++] = '\n';
+    if (write(fd, line, length) < 0) return;
+  }
+}
+
+/** Prints the latencies when the program exits normally */
+static void printStageLatenciesAtExit()
+{
+  // anything still buffered in stdout was printed first, so let it out first
+  fflush(stdout);
+  printStageLatencies(1);
+}
+
+/**
+ * Prints the latencies when the program is interrupted, then lets the signal
+ * kill the program as it would have without the dump
+ *
+ * @param signalNumber - the signal that was caught
+ */
+static void printStageLatenciesOnSignal(int signalNumber)
+{
+  printStageLatencies(2);
+
+  signal(signalNumber, SIG_DFL);
+  raise(signalNumber);
+}
+
+/**
+ * Has every stage's latencies printed once the program exits, whether it
+ * finishes normally or is stopped with Ctrl+C. Safe to call more than once.
+ */
+void installStageLatencyDump()
+{
+  static bool isInstalled = false;
+  if (isInstalled) return;
+  isInstalled = true;
+
+  atexit(printStageLatenciesAtExit);
+  signal(SIGINT,  printStageLatenciesOnSignal);
+  signal(SIGTERM, printStageLatenciesOnSignal);
+}
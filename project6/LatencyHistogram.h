@@ -0,0 +1,83 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+#pragma once
+
+#include <chrono>
+#include <stdint.h> // uint64_t
+
+/**
+ * Stages of the control loop that are timed. The first four are the parts of
+ * a single tick, the rest time a whole call from start to finish.
+ */
+namespace ProfileStage
+{
+  enum Enum { Read, Localize, Decide, Command,
+              FollowProfile, RotateToFace, AutoPilot, HandleBump,
+              Count };
+}
+
+/**
+ * Histogram of latencies in nanoseconds with a fixed relative precision, in the
+ * style of an HDR histogram. Values are bucketed by their power of two and each
+ * power of two is split into SUB_BUCKETS linear buckets, so any value is off by
+ * at most 1 / SUB_BUCKETS and recording is just a few bit operations.
+ */
+class LatencyHistogram
+{
+  static const int SUB_BUCKET_BITS = 4,
+                   SUB_BUCKETS     = 1 << SUB_BUCKET_BITS,
+                   BUCKET_COUNT    = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+  uint64_t counts[BUCKET_COUNT];
+  uint64_t count,  // number of values recorded
+           maxNs;  // largest value recorded
+
+  static int getBucket(uint64_t ns);
+  static uint64_t getBucketValue(int bucket);
+
+public:
+  // constructor
+  LatencyHistogram();
+
+  // recording
+  void record(uint64_t ns);
+  void reset();
+
+  // statistics
+  uint64_t getCount() const;
+  uint64_t getMax() const;
+  uint64_t getPercentile(double percentile) const;
+};
+
+/**
+ * Records how long it lives into the histogram of a stage. Declare one at the
+ * top of a scope with TIME_STAGE() to time the rest of the scope.
+ */
+class ScopedStageTimer
+{
+  ProfileStage::Enum stage;
+  std::chrono::steady_clock::time_point start;
+
+public:
+  ScopedStageTimer(ProfileStage::Enum stage) :
+    stage(stage),
+    start(std::chrono::steady_clock::now()) {}
+
+  ~ScopedStageTimer();
+};
+
+// timing is on unless DISABLE_STAGE_TIMING is defined when building
+#ifndef DISABLE_STAGE_TIMING
+#define TIME_STAGE_NAME(line) stageTimer##line
+#define TIME_STAGE_LINE(stage, line) ScopedStageTimer TIME_STAGE_NAME(line)(stage)
+#define TIME_STAGE(stage) TIME_STAGE_LINE(stage, __LINE__)
+#else
+#define TIME_STAGE(stage)
+#endif
+
+// every stage's histogram
+LatencyHistogram& getStageHistogram(ProfileStage::Enum stage);
+void printStageLatencies(int fd = 1);
+void installStageLatencyDump();
+
+#endif
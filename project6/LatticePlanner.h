@@ -0,0 +1,316 @@
+#ifndef LATTICE_PLANNER_H
+#define LATTICE_PLANNER_H
+#pragma once
+
+#include <algorithm> // std::fill, std::reverse
+#include <cmath>     // floor, M_PI
+#include <cstdio>    // printf
+#include <fstream>
+#include <queue>
+#include <string>
+#include <vector>
+#include "Grid.h"
+#include "Vector2.h"
+
+/**
+ * How long each motion takes the robot to carry out. Rotations are not free:
+ * the robot stops at every waypoint and rotateToFaceWaypoint() can take several
+ * passes, so a turn often costs as much as a whole straight leg.
+ */
+struct MotionCosts
+{
+  double cellTime,        // seconds to drive forward by a single cell
+         quarterTurnTime, // seconds to stop and rotate in place by 90 degrees
+         halfTurnTime;    // seconds to stop and rotate in place by 180 degrees
+
+  MotionCosts(double cellTime        = 1.0,
+              double quarterTurnTime = 4.0,
+              double halfTurnTime    = 6.0) :
+    cellTime(cellTime),
+    quarterTurnTime(quarterTurnTime),
+    halfTurnTime(halfTurnTime) {}
+
+  // save and load measured costs
+  bool readCosts(const std::string& fileName);
+  bool writeCosts(const std::string& fileName) const;
+};
+
+/**
+ * Reads in costs measured by time-motion. The file holds the cell, quarter turn
+ * and half turn times in seconds.
+ *
+ * @param fileName - name of the file to read from
+ * @return true if all three costs were read in. False leaves the costs unchanged
+ */
+inline bool MotionCosts::readCosts(const std::string& fileName)
+{
+  std::ifstream costFile(fileName.c_str());
+  double cell, quarter, half;
+
+  if (!(costFile >> cell >> quarter >> half)) return false;
+
+  cellTime        = cell;
+  quarterTurnTime = quarter;
+  halfTurnTime    = half;
+  return true;
+}
+
+/**
+ * Writes the costs out in the format readCosts() expects
+ *
+ * @param fileName - name of the file to write to
+ * @return true if the file could be opened
+ */
+inline bool MotionCosts::writeCosts(const std::string& fileName) const
+{
+  std::ofstream costFile(fileName.c_str());
+  if (!costFile.is_open()) return false;
+
+  costFile << cellTime << " " << quarterTurnTime << " " << halfTurnTime << "\n";
+  return true;
+}
+
+/**
+ * Planner over (x, y, heading) states. From each state the robot can drive
+ * forward a cell or turn in place by 90 or 180 degrees, each with the time it
+ * really takes, so the plan minimizes time to execute rather than distance.
+ * Headings follow GridDirection.
+ */
+template <class GridType>
+class LatticePlanner
+{
+  const GridType& grid;
+  MotionCosts costs;
+  int expandedCount; // number of states expanded by the last search
+
+  // search scratch space, one entry per (cell, heading) state
+  std::vector<double> timeSoFar;
+  std::vector<int>    parent;
+  std::vector<char>   isClosed;
+
+  double getHeuristic(int index, int goalIndex) const;
+
+public:
+  // constructor
+  LatticePlanner(const GridType& grid, MotionCosts costs = MotionCosts());
+
+  // conversions between yaw rotations and headings
+  static GridDirection::Enum yawToHeading(double yaw);
+
+  // searching
+  bool findPath(int startIndex, GridDirection::Enum startHeading, int goalIndex, std::vector<int>& states);
+  std::vector<Vector2> getWaypoints(Vector2 start, double startYaw, Vector2 goal);
+
+  // statistics
+  int    getExpandedCount() const;
+  double getPlanTime(const std::vector<int>& states) const;
+};
+
+/**
+ * State waiting to be expanded. Ordered so that the lowest estimated total time
+ * comes out of the priority queue first.
+ */
+struct OpenState
+{
+  double estimate; // time so far plus heuristic
+  int    state;    // cell index * GridDirection::Count + heading
+
+  OpenState(double estimate, int state) : estimate(estimate), state(state) {}
+
+  bool operator<(OpenState const& other) const { return estimate > other.estimate; }
+};
+
+/**
+ * Creates a new lattice planner for the given (already dilated) grid
+ *
+ * @param grid  - the grid to plan over
+ * @param costs - how long each motion takes
+ */
+template <class GridType>
+LatticePlanner<GridType>::LatticePlanner(const GridType& grid, MotionCosts costs) :
+  grid(grid),
+  costs(costs),
+  expandedCount(0),
+  timeSoFar(grid.getCellCount() * GridDirection::Count),
+  parent(grid.getCellCount() * GridDirection::Count),
+  isClosed(grid.getCellCount() * GridDirection::Count) {}
+
+/**
+ * Rounds a yaw rotation to the closest heading
+ *
+ * @param yaw - yaw rotation in radians, where 0 faces along the x axis
+ * @return the closest heading
+ */
+template <class GridType>
+GridDirection::Enum LatticePlanner<GridType>::yawToHeading(double yaw)
+{
+  // quarter turns counter-clockwise from facing right, between 0 and 3
+  int quarters = ((int)floor(yaw / (M_PI / 2.0) + 0.5) % 4 + 4) % 4;
+
+  const GridDirection::Enum headings[4] = { GridDirection::Right, GridDirection::Top,
+                                            GridDirection::Left,  GridDirection::Bottom };
+  return headings[quarters];
+}
+
+/**
+ * Lower bound on the time left to reach the goal. Every cell between here and the
+ * goal must be driven, and if the goal is not in a straight line at least one
+ * quarter turn is needed.
+ *
+ * @param index     - cell we are estimating from
+ * @param goalIndex - cell we are heading to
+ * @return estimated time in seconds
+ */
+template <class GridType>
+double LatticePlanner<GridType>::getHeuristic(int index, int goalIndex) const
+{
+  int width = grid.getWidth();
+  bool isStraight = index % width == goalIndex % width || index / width == goalIndex / width;
+
+  return grid.getManhattanDistance(index, goalIndex) * costs.cellTime +
+         (isStraight ? 0.0 : costs.quarterTurnTime);
+}
+
+/**
+ * Finds the fastest sequence of states from the start to the goal with A*.
+ * The robot may arrive at the goal facing any direction.
+ *
+ * @param startIndex   - index of the cell to start from
+ * @param startHeading - direction the robot is facing at the start
+ * @param goalIndex    - index of the cell to reach
+ * @param states       - filled in with every state from the start to the goal
+ * @return true if a path could be found. False otherwise
+ */
+template <class GridType>
+bool LatticePlanner<GridType>::findPath(int startIndex,
+                                        GridDirection::Enum startHeading,
+                                        int goalIndex,
+                                        std::vector<int>& states)
+{
+  const int DIRS = GridDirection::Count;
+
+  states.clear();
+  expandedCount = 0;
+
+  if (startIndex < 0 || goalIndex < 0 ||
+      grid.isOccupied(startIndex) || grid.isOccupied(goalIndex)) return false;
+
+  std::fill(timeSoFar.begin(), timeSoFar.end(), -1.0);
+  std::fill(isClosed.begin(),  isClosed.end(),  0);
+
+  std::priority_queue<OpenState> open;
+  int start = startIndex * DIRS + startHeading;
+  timeSoFar[start] = 0;
+  parent[start]    = -1;
+  open.push(OpenState(getHeuristic(startIndex, goalIndex), start));
+
+  while (!open.empty())
+  {
+    int state = open.top().state;
+    open.pop();
+
+    // skip stale entries for states that were already expanded
+    if (isClosed[state]) continue;
+    isClosed[state] = 1;
+    expandedCount++;
+
+    int index   = state / DIRS,
+        heading = state % DIRS;
+
+    // reached the goal, unwind the path
+    if (index == goalIndex)
+    {
+      for (int cur = state; cur != -1; cur = parent[cur]) states.push_back(cur);
+      std::reverse(states.begin(), states.end());
+      return true;
+    }
+
+    // drive forward, turn left, turn right, or turn around
+    int    next[4];
+    double time[4];
+
+    int ahead = grid.getNeighbor(index, (GridDirection::Enum)heading);
+    next[0] = ahead < 0 ? -1 : ahead * DIRS + heading;
+    next[1] = index * DIRS + (heading + 3) % DIRS;
+    next[2] = index * DIRS + (heading + 1) % DIRS;
+    next[3] = index * DIRS + (heading + 2) % DIRS;
+    time[0] = costs.cellTime;
+    time[1] = costs.quarterTurnTime;
+    time[2] = costs.quarterTurnTime;
+    time[3] = costs.halfTurnTime;
+
+    for (int i = 0; i < 4; i++)
+    {
+      if (next[i] < 0 || isClosed[next[i]]) continue;
+
+      double t = timeSoFar[state] + time[i];
+      if (timeSoFar[next[i]] >= 0 && t >= timeSoFar[next[i]]) continue;
+
+      timeSoFar[next[i]] = t;
+      parent[next[i]]    = state;
+      open.push(OpenState(t + getHeuristic(next[i] / DIRS, goalIndex), next[i]));
+    }
+  }
+
+  return false;
+}
+
+/**
+ * Obtains the waypoints between 2 points. A waypoint is placed wherever the
+ * robot has to turn, which is also where moveToWaypoint() will stop it.
+ *
+ * @param start    - coord of the starting location
+ * @param startYaw - yaw rotation of the robot at the start in radians
+ * @param goal     - coord of the end location
+ * @return waypoints for the robot to follow. Empty if there is no path
+ */
+template <class GridType>
+std::vector<Vector2> LatticePlanner<GridType>::getWaypoints(Vector2 start, double startYaw, Vector2 goal)
+{
+  const int DIRS = GridDirection::Count;
+
+  std::vector<Vector2> waypoints;
+  std::vector<int>     states;
+
+  if (!findPath(grid.worldToIndex(start), yawToHeading(startYaw), grid.worldToIndex(goal), states))
+  {
+    printf("ERROR! Cannot find path between points (%.1f, %.1f) and (%.1f %.1f).\n",
+           start.x, start.y, goal.x, goal.y);
+    return waypoints;
+  }
+
+  // add the start, then every cell where the robot turns
+  waypoints.push_back(grid.indexToWorld(states[0] / DIRS));
+  for (int i = 1; i + 1 < (int)states.size(); i++)
+  {
+    int cell = states[i] / DIRS;
+    if (states[i + 1] / DIRS == cell && states[i - 1] / DIRS != cell)
+    {
+      waypoints.push_back(grid.indexToWorld(cell));
+    }
+  }
+
+  // add the final point
+  waypoints.push_back(grid.indexToWorld(states.back() / DIRS));
+
+  return waypoints;
+}
+
+/** @return number of states expanded by the last search */
+template <class GridType>
+int LatticePlanner<GridType>::getExpandedCount() const
+{
+  return expandedCount;
+}
+
+/**
+ * @param states - states found by findPath()
+ * @return the time it should take to drive the states in seconds
+ */
+template <class GridType>
+double LatticePlanner<GridType>::getPlanTime(const std::vector<int>& states) const
+{
+  return states.empty() ? 0.0 : timeSoFar[states.back()];
+}
+
+#endif
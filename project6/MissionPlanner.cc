@@ -0,0 +1,173 @@
+#include "MissionPlanner.h"
+#include <algorithm> // std::reverse
+
+// the longest run of goals Or-opt will try to move at once
+#define OR_OPT_MAX_SEGMENT 3
+
+/**
+ * Creates a new mission planner
+ *
+ * @param costs     - cost matrix where costs[from * nodeCount + to] is the cost to
+ *                    travel between two nodes. Node 0 is the start
+ * @param nodeCount - the start plus every goal
+ */
+MissionPlanner::MissionPlanner(const std::vector<int>& costs, int nodeCount) :
+  nodeCount(nodeCount),
+  costs(costs) {}
+
+/**
+ * Cost of travelling between two nodes. The tour does not return to the start,
+ * so leaving the last node (to == -1) is free.
+ *
+ * @param from - node we are leaving
+ * @param to   - node we are heading to, or -1 for the end of the tour
+ * @return cost of the edge, INT_MAX if there is no path
+ */
+long long MissionPlanner::getEdgeCost(int from, int to) const
+{
+  if (to < 0) return 0;
+
+  return costs[from * nodeCount + to];
+}
+
+/**
+ * Total cost of visiting the nodes in the given order
+ *
+ * @param tour - order to visit the nodes in, starting with node 0
+ * @return sum of the cost of every edge in the tour
+ */
+long long MissionPlanner::getTourCost(const std::vector<int>& tour) const
+{
+  long long total = 0;
+  for (int i = 0; i + 1 < (int)tour.size(); i++)
+  {
+    total += getEdgeCost(tour[i], tour[i + 1]);
+  }
+
+  return total;
+}
+
+/**
+ * Builds a first guess at the tour by always heading to the closest goal
+ * that has not been visited yet
+ *
+ * @param tour - filled in with the order to visit the nodes in
+ */
+void MissionPlanner::buildNearestNeighborTour(std::vector<int>& tour) const
+{
+  std::vector<char> wasVisited(nodeCount, 0);
+
+  tour.clear();
+  tour.push_back(0);
+  wasVisited[0] = 1;
+
+  while ((int)tour.size() < nodeCount)
+  {
+    int cur = tour.back(), next = -1;
+
+    for (int i = 1; i < nodeCount; i++)
+    {
+      if (wasVisited[i]) continue;
+      if (next < 0 || getEdgeCost(cur, i) < getEdgeCost(cur, next)) next = i;
+    }
+
+    tour.push_back(next);
+    wasVisited[next] = 1;
+  }
+}
+
+/**
+ * Reverses the first section of the tour that makes it shorter. The start of
+ * the tour never moves.
+ *
+ * @param tour - tour to improve
+ * @return true if the tour was improved
+ */
+bool MissionPlanner::improveWithTwoOpt(std::vector<int>& tour) const
+{
+  int n = tour.size();
+
+  for (int i = 1; i < n - 1; i++)
+  {
+    for (int j = i + 1; j < n; j++)
+    {
+      int after = j + 1 < n ? tour[j + 1] : -1;
+
+      // cost of the two edges on either side of the section before and after reversing it
+      long long before   = getEdgeCost(tour[i - 1], tour[i]) + getEdgeCost(tour[j], after),
+                reversed = getEdgeCost(tour[i - 1], tour[j]) + getEdgeCost(tour[i], after);
+
+      if (reversed < before)
+      {
+        std::reverse(tour.begin() + i, tour.begin() + j + 1);
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+/**
+ * Moves the first short run of goals to a spot in the tour where it makes the
+ * tour shorter. The start of the tour never moves.
+ *
+ * @param tour - tour to improve
+ * @return true if the tour was improved
+ */
+bool MissionPlanner::improveWithOrOpt(std::vector<int>& tour) const
+{
+  int n = tour.size();
+
+  for (int length = 1; length <= OR_OPT_MAX_SEGMENT; length++)
+  {
+    for (int i = 1; i + length <= n; i++)
+    {
+      int first = tour[i],
+          last  = tour[i + length - 1],
+          prev  = tour[i - 1],
+          next  = i + length < n ? tour[i + length] : -1;
+
+      // how much cutting the run out of the tour saves
+      long long removed = getEdgeCost(prev, first) + getEdgeCost(last, next) - getEdgeCost(prev, next);
+
+      // try placing the run after every node outside of it
+      for (int k = 0; k < n; k++)
+      {
+        if (k >= i - 1 && k < i + length) continue;
+
+        int a = tour[k],
+            b = k + 1 < n ? tour[k + 1] : -1;
+
+        long long added = getEdgeCost(a, first) + getEdgeCost(last, b) - getEdgeCost(a, b);
+        if (added >= removed) continue;
+
+        // move the run to its new spot
+        std::vector<int> run(tour.begin() + i, tour.begin() + i + length);
+        tour.erase(tour.begin() + i, tour.begin() + i + length);
+
+        int insertAt = k < i ? k + 1 : k + 1 - length;
+        tour.insert(tour.begin() + insertAt, run.begin(), run.end());
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+/**
+ * Finds a short order to visit every goal in
+ *
+ * @return order to visit the nodes in, starting with node 0
+ */
+std::vector<int> MissionPlanner::getVisitOrder() const
+{
+  std::vector<int> tour;
+  buildNearestNeighborTour(tour);
+
+  // keep improving the tour until neither move finds anything
+  while (improveWithTwoOpt(tour) || improveWithOrOpt(tour));
+
+  return tour;
+}
@@ -0,0 +1,120 @@
+#ifndef MISSION_PLANNER_H
+#define MISSION_PLANNER_H
+#pragma once
+
+#include <algorithm>  // std::min, std::max
+#include <climits>    // INT_MAX
+#include <functional> // std::cref, std::ref
+#include <thread>
+#include <vector>
+#include "GridPlanner.h"
+
+/**
+ * Decides the order to visit a list of goals in so the total path length is
+ * as short as possible (an open travelling salesman tour from the start).
+ *
+ * Node 0 of the cost matrix is always the robot's starting cell and nodes
+ * 1 to n are the goals. The tour starts from a nearest neighbor guess and is
+ * then improved with 2-opt and Or-opt moves until neither finds anything.
+ *
+ * Unreachable pairs cost INT_MAX, so costs are added up as long long to keep
+ * a tour with several of them from overflowing. Such tours still cost more
+ * than any tour without them.
+ */
+class MissionPlanner
+{
+  int nodeCount;          // the start plus every goal
+  std::vector<int> costs; // costs[from * nodeCount + to], in cells
+
+  long long getEdgeCost(int from, int to) const;
+  void buildNearestNeighborTour(std::vector<int>& tour) const;
+  bool improveWithTwoOpt(std::vector<int>& tour) const;
+  bool improveWithOrOpt(std::vector<int>& tour) const;
+
+public:
+  // constructor
+  MissionPlanner(const std::vector<int>& costs, int nodeCount);
+
+  // find the order to visit the goals in
+  std::vector<int> getVisitOrder() const;
+
+  // total cost of visiting the nodes in the given order
+  long long getTourCost(const std::vector<int>& tour) const;
+};
+
+/**
+ * Fills in every row of the cost matrix that belongs to this worker. Each worker
+ * gets its own planner so no search scratch space is shared between threads.
+ *
+ * @param grid   - the (already dilated) grid to plan over
+ * @param cells  - index of the cell of every node, or -1 for a node off the map
+ * @param costs  - cost matrix being filled in
+ * @param first  - first row for this worker to compute
+ * @param stride - number of rows between each row this worker computes
+ */
+template <class GridType>
+void computePathCostRows(const GridType& grid,
+                         const std::vector<int>& cells,
+                         std::vector<int>& costs,
+                         int first,
+                         int stride)
+{
+  GridPlanner<GridType> planner(grid, HeuristicMethod::Manhattan);
+  std::vector<int> wavefront;
+  int n = cells.size();
+
+  for (int from = first; from < n; from += stride)
+  {
+    // nothing reaches a node that is off the map, or leaves one
+    if (cells[from] < 0)
+    {
+      for (int to = 0; to < n; to++) costs[from * n + to] = INT_MAX;
+      continue;
+    }
+
+    // a single wavefront from each node reaches every other node at once
+    planner.getWavefrontCosts(cells[from], wavefront);
+
+    for (int to = 0; to < n; to++)
+    {
+      costs[from * n + to] = cells[to] < 0 ? INT_MAX : wavefront[cells[to]];
+    }
+  }
+}
+
+/**
+ * Computes the cost of the shortest path between every pair of cells, with the
+ * rows of the matrix spread across threads.
+ *
+ * @param grid        - the (already dilated) grid to plan over
+ * @param cells       - index of the cell of every node, or -1 for a node off the map
+ * @param threadCount - number of threads to use. 0 uses one per core
+ * @return cost matrix where costs[from * cells.size() + to] is in cells, or
+ *         INT_MAX when there is no path or either node is off the map
+ */
+template <class GridType>
+std::vector<int> getPathCosts(const GridType& grid, const std::vector<int>& cells, int threadCount = 0)
+{
+  int n = cells.size();
+  std::vector<int> costs(n * n);
+
+  if (threadCount < 1) threadCount = std::thread::hardware_concurrency();
+  threadCount = std::min(std::max(threadCount, 1), std::max(n, 1));
+
+  // spread the rows across the workers
+  std::vector<std::thread> workers;
+  for (int t = 1; t < threadCount; t++)
+  {
+    workers.push_back(std::thread(computePathCostRows<GridType>,
+                                  std::cref(grid), std::cref(cells), std::ref(costs), t, threadCount));
+  }
+
+  // this thread does its share too
+  computePathCostRows(grid, cells, costs, 0, threadCount);
+
+  for (int t = 0; t < (int)workers.size(); t++) workers[t].join();
+
+  return costs;
+}
+
+#endif
@@ -0,0 +1,163 @@
+#ifndef MOTION_CALIBRATION_H
+#define MOTION_CALIBRATION_H
+#pragma once
+
+#include <cmath>   // fabs
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ * How much to scale velocity commands by so the robot really moves at the
+ * velocity asked for. Each command is the wanted velocity times the scale,
+ * plus the bias in the direction of motion to get past the motors' dead band.
+ * Measured by Robot::calibrate() and kept in a file per robot.
+ */
+struct MotionCalibration
+{
+  double movementScale, // command per m/s wanted
+         movementBias,  // m/s added to every forward command
+         rotationScale, // command per rad/s wanted
+         rotationBias;  // rad/s added to every angular command
+
+  MotionCalibration(double movementScale = 1.0, double rotationScale = 1.0) :
+    movementScale(movementScale),
+    movementBias(0),
+    rotationScale(rotationScale),
+    rotationBias(0) {}
+
+  double getCommand(double velocity, bool isRotation) const;
+  double getVelocity(double command, bool isRotation) const;
+  bool readCalibration(const std::string& fileName);
+  bool writeCalibration(const std::string& fileName) const;
+};
+
+/**
+ * @param velocity   - velocity the robot should really move at in m/s or rad/s
+ * @param isRotation - true for an angular velocity, false for a forward velocity
+ * @return the velocity to command
+ */
+inline double MotionCalibration::getCommand(double velocity, bool isRotation) const
+{
+  if (velocity == 0) return 0;
+
+  double scale = isRotation ? rotationScale : movementScale,
+         bias  = isRotation ? rotationBias  : movementBias,
+         size  = fabs(velocity) * scale + bias;
+
+  // a negative bias must never turn the command around
+  if (size < 0) size = 0;
+
+  return velocity < 0 ? -size : size;
+}
+
+/**
+ * Undoes getCommand()
+ *
+ * @param command    - velocity the robot was commanded to move at
+ * @param isRotation - true for an angular velocity, false for a forward velocity
+ * @return the velocity the robot should really move at in m/s or rad/s
+ */
+inline double MotionCalibration::getVelocity(double command, bool isRotation) const
+{
+  double scale = isRotation ? rotationScale : movementScale,
+         bias  = isRotation ? rotationBias  : movementBias,
+         size  = scale > 0 ? (fabs(command) - bias) / scale : 0;
+
+  // commands inside the dead band do not move the robot
+  if (size < 0) size = 0;
+
+  return command < 0 ? -size : size;
+}
+
+/**
+ * Reads in a calibration written by writeCalibration(). The file holds the
+ * movement scale and bias followed by the rotation scale and bias.
+ *
+ * @param fileName - name of the file to read from
+ * @return true if all four values were read in. False leaves the calibration unchanged
+ */
+inline bool MotionCalibration::readCalibration(const std::string& fileName)
+{
+  std::ifstream calibrationFile(fileName.c_str());
+  double moveScale, moveBias, rotateScale, rotateBias;
+
+  if (!(calibrationFile >> moveScale >> moveBias >> rotateScale >> rotateBias)) return false;
+
+  movementScale = moveScale;
+  movementBias  = moveBias;
+  rotationScale = rotateScale;
+  rotationBias  = rotateBias;
+  return true;
+}
+
+/**
+ * Writes the calibration out in the format readCalibration() expects
+ *
+ * @param fileName - name of the file to write to
+ * @return true if the file could be opened
+ */
+inline bool MotionCalibration::writeCalibration(const std::string& fileName) const
+{
+  std::ofstream calibrationFile(fileName.c_str());
+  if (!calibrationFile.is_open()) return false;
+
+  calibrationFile << movementScale << " " << movementBias  << " " <<
+                     rotationScale << " " << rotationBias  << "\n";
+  return true;
+}
+
+/**
+ * Fits the scale and bias that turn wanted velocities into commands, given the
+ * velocities measured for a number of test commands. Fits measured = a * command + b
+ * by least squares on the size of each velocity, then inverts it.
+ *
+ * @param commands - velocity sent for each test
+ * @param measured - velocity the robot really moved at for each test
+ * @param scale    - set to the fitted scale
+ * @param bias     - set to the fitted bias
+ * @return true if the fit makes sense. False leaves scale and bias unchanged
+ */
+inline bool fitMotionCalibration(const std::vector<double>& commands,
+                                 const std::vector<double>& measured,
+                                 double& scale,
+                                 double& bias)
+{
+  int    n  = commands.size();
+  double sx = 0, sy = 0, sxx = 0, sxy = 0;
+
+  for (int i = 0; i < n; i++)
+  {
+    double x = fabs(commands[i]),
+           y = fabs(measured[i]);
+    sx  += x;
+    sy  += y;
+    sxx += x * x;
+    sxy += x * y;
+  }
+
+  double denominator = n * sxx - sx * sx,
+         a, b;
+
+  // with only one size of command tested there is no telling scale and bias apart
+  if (n >= 2 && denominator > 1e-9 * n * sxx)
+  {
+    a = (n * sxy - sx * sy) / denominator;
+    b = (sy - a * sx) / n;
+  }
+  else if (sxx > 0)
+  {
+    a = sxy / sxx;
+    b = 0;
+  }
+  else return false;
+
+  // the robot must move the way it was told to
+  if (a <= 0) return false;
+
+  scale = 1.0 / a;
+  bias  = -b / a;
+  return true;
+}
+
+#endif
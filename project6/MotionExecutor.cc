@@ -0,0 +1,284 @@
+#include "MotionExecutor.h"
+#include <chrono>
+
+/** @return where the motion is up to. Failed for a handle to no motion */
+MotionStatus::Enum MotionHandle::getStatus() const
+{
+  return task ? (MotionStatus::Enum)task->status.load() : MotionStatus::Failed;
+}
+
+/** @return true if the handle refers to a motion */
+bool MotionHandle::isValid() const
+{
+  return (bool)task;
+}
+
+/** @return true once the motion has ended, however it ended */
+bool MotionHandle::isDone() const
+{
+  return getStatus() >= MotionStatus::Succeeded;
+}
+
+/**
+ * Blocks until the motion ends
+ *
+ * @return true if the motion finished what it set out to do
+ */
+bool MotionHandle::wait() const
+{
+  if (!task) return false;
+
+  std::unique_lock<std::mutex> lock(task->mutex);
+  task->ended.wait(lock, [this] { return task->status >= MotionStatus::Succeeded; });
+
+  return task->status == MotionStatus::Succeeded;
+}
+
+/**
+ * Blocks until the motion ends or the time runs out
+ *
+ * @param seconds - longest time to wait for
+ * @return true if the motion ended in time, however it ended
+ */
+bool MotionHandle::waitFor(double seconds) const
+{
+  if (!task) return true;
+
+  std::unique_lock<std::mutex> lock(task->mutex);
+  return task->ended.wait_for(lock, std::chrono::duration<double>(seconds),
+                              [this] { return task->status >= MotionStatus::Succeeded; });
+}
+
+/**
+ * Cancels the motion. A queued motion never starts, and a running motion
+ * stops the robot within a tick. Does nothing once the motion has ended.
+ */
+void MotionHandle::cancel() const
+{
+  if (!task) return;
+
+  std::lock_guard<std::mutex> lock(task->mutex);
+  task->isCancelled = true;
+  if (task->robot) task->robot->cancelMotion();
+}
+
+/**
+ * Takes over the robot and starts the thread that runs its motions
+ *
+ * @param robot - the robot to drive. Must outlive the executor
+ */
+MotionExecutor::MotionExecutor(Robot& robot) :
+  robot(robot),
+  isStopping(false),
+  latestState(robot.getState())
+{
+  // keep a copy of every snapshot so other threads can see where the robot is
+  robot.setReadListener([this](const RobotState& state)
+  {
+    std::lock_guard<std::mutex> lock(stateMutex);
+    latestState = state;
+  });
+
+  worker = std::thread(&MotionExecutor::run, this);
+}
+
+/** Cancels every motion, waits for the robot to stop and hands the robot back */
+MotionExecutor::~MotionExecutor()
+{
+  cancelAll();
+
+  {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    isStopping = true;
+  }
+  queueChanged.notify_all();
+  worker.join();
+
+  // anything still queued will never run
+  for (int i = 0; i < (int)queue.size(); i++) finish(queue[i], MotionStatus::Cancelled);
+  queue.clear();
+
+  robot.setReadListener(std::function<void(const RobotState&)>());
+  robot.clearCancel();
+}
+
+/** Body of the executor's thread. Runs queued motions in order until the executor is destroyed */
+void MotionExecutor::run()
+{
+  while (1)
+  {
+    std::shared_ptr<MotionTask> task;
+    {
+      std::unique_lock<std::mutex> lock(queueMutex);
+      queueChanged.wait(lock, [this] { return isStopping || !queue.empty(); });
+      if (isStopping) break;
+
+      task = queue.front();
+      queue.pop_front();
+      running = task;
+    }
+
+    // let the robot know about cancels from now on, including one that came in before it started
+    {
+      std::lock_guard<std::mutex> lock(task->mutex);
+      robot.clearCancel();
+      task->robot = &robot;
+      if (task->isCancelled) robot.cancelMotion();
+      else                   task->status = MotionStatus::Running;
+    }
+
+    bool isFinished = !task->isCancelled && task->body(robot);
+
+    // cancels after this point are too late to do anything
+    {
+      std::lock_guard<std::mutex> lock(task->mutex);
+      task->robot = NULL;
+    }
+
+    // not every motion stops the robot when it is interrupted
+    if (task->isCancelled) robot.setSpeed(0, 0, TurnDirection::None);
+
+    {
+      std::lock_guard<std::mutex> lock(queueMutex);
+      running.reset();
+    }
+
+    finish(task, task->isCancelled ? MotionStatus::Cancelled :
+                 isFinished        ? MotionStatus::Succeeded : MotionStatus::Failed);
+  }
+}
+
+/**
+ * Marks a motion as ended and wakes anything waiting on it
+ *
+ * @param task   - the motion that ended
+ * @param status - how it ended
+ */
+void MotionExecutor::finish(const std::shared_ptr<MotionTask>& task, MotionStatus::Enum status)
+{
+  {
+    std::lock_guard<std::mutex> lock(task->mutex);
+    task->status = status;
+  }
+  task->ended.notify_all();
+}
+
+/**
+ * Queues up any motion. It runs on the executor's thread once every motion
+ * queued before it has ended.
+ *
+ * @param body - runs the motion on the robot and returns true if it finished.
+ *               It should check Robot::isMotionCancelled() at least once a tick
+ * @return handle to the motion
+ */
+MotionHandle MotionExecutor::submit(std::function<bool(Robot&)> body)
+{
+  std::shared_ptr<MotionTask> task(new MotionTask(body));
+  {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    queue.push_back(task);
+  }
+  queueChanged.notify_one();
+
+  return MotionHandle(task);
+}
+
+/** Queues up Robot::moveForwardByMeters() */
+MotionHandle MotionExecutor::moveForwardByMeters(double distanceInMeters, double forwardVelocity)
+{
+  return submit([=](Robot& robot) { return robot.moveForwardByMeters(distanceInMeters, forwardVelocity); });
+}
+
+/** Queues up Robot::rotateByRadians() */
+MotionHandle MotionExecutor::rotateByRadians(double radiansToRotate, double angularVelocity)
+{
+  return submit([=](Robot& robot) { return robot.rotateByRadians(radiansToRotate, angularVelocity); });
+}
+
+/** Queues up Robot::rotateToFaceWaypoint() */
+MotionHandle MotionExecutor::rotateToFaceWaypoint(Vector2 wp, double angularVelocity, double errorRange)
+{
+  return submit([=](Robot& robot) mutable
+  {
+    robot.rotateToFaceWaypoint(wp, angularVelocity, errorRange);
+    return true;
+  });
+}
+
+/** Queues up Robot::moveToWaypoint(). The bumper handler must outlive the motion */
+MotionHandle MotionExecutor::moveToWaypoint(Vector2 wp,
+                                            BumperEventState& bumperEventState,
+                                            double velocity,
+                                            double angularVelocity,
+                                            double errorRange)
+{
+  BumperEventState *handler = &bumperEventState;
+  return submit([=](Robot& robot) mutable
+  {
+    robot.moveToWaypoint(wp, *handler, velocity, angularVelocity, errorRange);
+    return robot.hasReachedWaypoint(wp, errorRange);
+  });
+}
+
+/** Queues up Robot::followPath(). The bumper handler must outlive the motion */
+MotionHandle MotionExecutor::followPath(const std::vector<Vector2>& waypoints,
+                                        BumperEventState& bumperEventState,
+                                        double velocity,
+                                        double angularVelocity,
+                                        double errorRange,
+                                        PathTracker::Enum tracker)
+{
+  BumperEventState *handler = &bumperEventState;
+  return submit([=](Robot& robot) mutable
+  {
+    if (waypoints.empty()) return true;
+
+    Vector2 goal = waypoints.back();
+    robot.followPath(waypoints, *handler, velocity, angularVelocity, errorRange, tracker);
+    return robot.hasReachedWaypoint(goal, errorRange);
+  });
+}
+
+/** Queues up Robot::localize() */
+MotionHandle MotionExecutor::localize()
+{
+  return submit([](Robot& robot)
+  {
+    robot.localize();
+    return robot.isLocalized();
+  });
+}
+
+/** Queues up Robot::autoPilotLaser(). Stops the robot once it is done */
+MotionHandle MotionExecutor::autoPilotLaser(int tickDuration, double forwardVelocity, double angularVelocity)
+{
+  return submit([=](Robot& robot)
+  {
+    robot.autoPilotLaser(tickDuration, forwardVelocity, angularVelocity);
+    robot.setSpeed(0, 0, TurnDirection::None);
+    return true;
+  });
+}
+
+/** Cancels the running motion and every queued one */
+void MotionExecutor::cancelAll()
+{
+  std::lock_guard<std::mutex> lock(queueMutex);
+
+  for (int i = 0; i < (int)queue.size(); i++) MotionHandle(queue[i]).cancel();
+  if (running) MotionHandle(running).cancel();
+}
+
+/** @return true if no motion is running or queued */
+bool MotionExecutor::isIdle()
+{
+  std::lock_guard<std::mutex> lock(queueMutex);
+  return queue.empty() && !running;
+}
+
+/** @return copy of the robot's latest snapshot */
+RobotState MotionExecutor::getState() const
+{
+  std::lock_guard<std::mutex> lock(stateMutex);
+  return latestState;
+}
@@ -0,0 +1,130 @@
+#ifndef MOTION_EXECUTOR_H
+#define MOTION_EXECUTOR_H
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Robot.h"
+
+/**
+ * Where a motion handed to a MotionExecutor is up to
+ */
+namespace MotionStatus
+{
+  enum Enum { Queued, Running, Succeeded, Failed, Cancelled };
+}
+
+/**
+ * A motion waiting for or being run by a MotionExecutor, shared between the
+ * executor and every handle to it.
+ */
+struct MotionTask
+{
+  std::function<bool(Robot&)> body;        // runs the motion, returns true if it finished
+  std::atomic<int>            status;      // a MotionStatus
+  std::atomic<bool>           isCancelled; // true once cancel() has been called on a handle
+  Robot                      *robot;       // robot running the motion, NULL unless it is running
+  std::mutex                  mutex;       // held while using robot or waiting for the motion to end
+  std::condition_variable     ended;       // signalled once the motion ends
+
+  MotionTask(std::function<bool(Robot&)> body) :
+    body(body),
+    status(MotionStatus::Queued),
+    isCancelled(false),
+    robot(NULL) {}
+};
+
+/**
+ * Handle to a motion handed to a MotionExecutor. Handles are cheap to copy and
+ * every copy refers to the same motion. The motion goes on whether or not any
+ * handle to it is kept.
+ */
+class MotionHandle
+{
+  std::shared_ptr<MotionTask> task;
+
+public:
+  // constructor
+  MotionHandle(std::shared_ptr<MotionTask> task = std::shared_ptr<MotionTask>()) : task(task) {}
+
+  // polling
+  MotionStatus::Enum getStatus() const;
+  bool isValid() const;
+  bool isDone() const;
+
+  // waiting
+  bool wait() const;
+  bool waitFor(double seconds) const;
+
+  // cancelling
+  void cancel() const;
+};
+
+/**
+ * Runs motions on the robot one after another on a thread of its own, so the
+ * thread that handed them over is free to plan the next leg, watch the camera
+ * or anything else while the robot drives. Every motion hands back a
+ * MotionHandle that can be polled, waited on or cancelled.
+ *
+ * Once the executor is running it owns the robot: nothing else may call the
+ * robot's methods until it is destroyed. getState() gives a copy of the
+ * latest snapshot for anything that needs to know where the robot is.
+ */
+class MotionExecutor
+{
+  Robot& robot;
+
+  std::thread                              worker;
+  std::mutex                               queueMutex;  // held while using queue or running
+  std::condition_variable                  queueChanged;
+  std::deque<std::shared_ptr<MotionTask> > queue;       // motions waiting to run, oldest first
+  std::shared_ptr<MotionTask>              running;     // the motion being run, if any
+  bool                                     isStopping;  // true once the executor is being destroyed
+
+  mutable std::mutex stateMutex; // held while using latestState
+  RobotState         latestState;
+
+  void run();
+  void finish(const std::shared_ptr<MotionTask>& task, MotionStatus::Enum status);
+
+public:
+  // constructor
+  MotionExecutor(Robot& robot);
+
+  // destructor
+  ~MotionExecutor();
+
+  // submitting motions
+  MotionHandle submit(std::function<bool(Robot&)> body);
+  MotionHandle moveForwardByMeters(double distanceInMeters, double forwardVelocity = 0.5);
+  MotionHandle rotateByRadians(double radiansToRotate, double angularVelocity = 0.5);
+  MotionHandle rotateToFaceWaypoint(Vector2 wp, double angularVelocity = 0.5, double errorRange = 0.0175);
+  MotionHandle moveToWaypoint(Vector2 wp,
+                              BumperEventState& bumperEventState,
+                              double velocity        = 0.5,
+                              double angularVelocity = 0.5,
+                              double errorRange      = 0.25);
+  MotionHandle followPath(const std::vector<Vector2>& waypoints,
+                          BumperEventState& bumperEventState,
+                          double velocity           = 0.5,
+                          double angularVelocity    = 1.0,
+                          double errorRange         = 0.25,
+                          PathTracker::Enum tracker = PathTracker::PurePursuit);
+  MotionHandle localize();
+  MotionHandle autoPilotLaser(int tickDuration = INT_MAX, double forwardVelocity = 0.5, double angularVelocity = 1.0);
+
+  // control
+  void cancelAll();
+  bool isIdle();
+
+  // the robot's latest snapshot, safe to call from any thread
+  RobotState getState() const;
+};
+
+#endif
@@ -0,0 +1,174 @@
+#include "MotionMonitor.h"
+#include <algorithm> // std::min, std::max
+#include <cmath>     // atan2, cos, sin, fabs, hypot
+
+// noise expected in the disagreement at each estimate, as a base amount plus a share of the motion
+const double POSITION_NOISE   = 0.02; // meters
+const double YAW_NOISE        = 0.02; // radians
+const double PROPORTION_NOISE = 0.1;  // share of the distance or angle moved
+
+const double SLIP_DRIFT     = 0.5; // standard deviations each disagreement must beat to count towards slip
+const double SLIP_THRESHOLD = 8.0; // standard deviations of slip added up before it is reported
+const double SLIP_CLIP      = 3.0; // largest disagreement in standard deviations counted towards slip
+
+const double JUMP_THRESHOLD     = 6.0; // standard deviations in a single estimate that count as a jump
+const double JUMP_KEPT_FRACTION = 0.5; // share of the jump localization must stay away by
+const int    JUMP_CONFIRM_COUNT = 2;   // new localization estimates a jump must last for before it is reported
+
+/**
+ * @param yaw - angle in radians
+ * @return the same angle between -PI and PI
+ */
+static double wrapAngle(double yaw)
+{
+  return atan2(sin(yaw), cos(yaw));
+}
+
+/** Creates a monitor that has seen nothing yet */
+MotionMonitor::MotionMonitor() :
+  glitchCount(0)
+{
+  reset(Vector2(), 0, Vector2(), 0);
+}
+
+/**
+ * Forgets everything seen so far and starts watching from the given poses
+ *
+ * @param odometerPos  - position according to the odometer
+ * @param odometerYaw  - yaw according to the odometer
+ * @param localizedPos - position according to localization
+ * @param localizedYaw - yaw according to localization
+ */
+void MotionMonitor::reset(Vector2 odometerPos, double odometerYaw, Vector2 localizedPos, double localizedYaw)
+{
+  lastOdometerPos  = odometerPos;
+  lastOdometerYaw  = odometerYaw;
+  lastLocalizedPos = localizedPos;
+  lastLocalizedYaw = localizedYaw;
+
+  slipHigh  = 0;
+  slipLow   = 0;
+  jumpCount = 0;
+  fault     = MotionFault::None;
+}
+
+/**
+ * Takes in the latest poses and checks whether they still agree. Only does
+ * anything once localization has a new estimate.
+ *
+ * @param odometerPos  - position according to the odometer
+ * @param odometerYaw  - yaw according to the odometer
+ * @param localizedPos - position according to localization
+ * @param localizedYaw - yaw according to localization
+ * @return the fault found so far. Once a fault is found it stays until reset() is called
+ */
+MotionFault::Enum MotionMonitor::update(Vector2 odometerPos, double odometerYaw, Vector2 localizedPos, double localizedYaw)
+{
+  // localization only moves the robot when it has a new estimate, so the odometer's motion
+  // is saved up until then rather than being read as localization falling behind
+  if (localizedPos.x == lastLocalizedPos.x && localizedPos.y == lastLocalizedPos.y &&
+      localizedYaw   == lastLocalizedYaw) return fault;
+
+  // the odometer's motion since the last estimate, turned to line up with localization's frame
+  double turn       = wrapAngle(lastLocalizedYaw - lastOdometerYaw),
+         odomX      = odometerPos.x - lastOdometerPos.x,
+         odomY      = odometerPos.y - lastOdometerPos.y,
+         odomDX     = cos(turn) * odomX - sin(turn) * odomY,
+         odomDY     = sin(turn) * odomX + cos(turn) * odomY,
+         odomDYaw   = wrapAngle(odometerYaw - lastOdometerYaw),
+         odomLength = hypot(odomDX, odomDY);
+
+  // how much localization disagrees with it
+  double errorX   = localizedPos.x - lastLocalizedPos.x - odomDX,
+         errorY   = localizedPos.y - lastLocalizedPos.y - odomDY,
+         errorYaw = wrapAngle(localizedYaw - lastLocalizedYaw - odomDYaw);
+
+  lastOdometerPos  = odometerPos;
+  lastOdometerYaw  = odometerYaw;
+  lastLocalizedPos = localizedPos;
+  lastLocalizedYaw = localizedYaw;
+
+  if (fault != MotionFault::None) return fault;
+
+  // the disagreement in standard deviations
+  double positionSigma = POSITION_NOISE + PROPORTION_NOISE * odomLength,
+         yawSigma      = YAW_NOISE      + PROPORTION_NOISE * fabs(odomDYaw),
+         size          = std::max(hypot(errorX, errorY) / positionSigma, fabs(errorYaw) / yawSigma);
+
+  // a jump only counts once localization has stayed where it jumped to
+  if (jumpCount > 0)
+  {
+    offset.x  += errorX;
+    offset.y  += errorY;
+    yawOffset += errorYaw;
+
+    // share of the jump that is still there, measured the way the jump was biggest
+    double kept = isYawJump ? yawOffset / jumpYawOffset :
+                  (offset.x * jumpOffset.x + offset.y * jumpOffset.y) /
+                  (jumpOffset.x * jumpOffset.x + jumpOffset.y * jumpOffset.y);
+
+    if (kept < JUMP_KEPT_FRACTION)
+    {
+      glitchCount++;
+      jumpCount = 0;
+    }
+    else if (++jumpCount > JUMP_CONFIRM_COUNT) fault = MotionFault::Jump;
+
+    return fault;
+  }
+
+  if (size > JUMP_THRESHOLD)
+  {
+    jumpOffset    = Vector2(errorX, errorY);
+    jumpYawOffset = errorYaw;
+    isYawJump     = fabs(errorYaw) / yawSigma > hypot(errorX, errorY) / positionSigma;
+    offset        = jumpOffset;
+    yawOffset     = errorYaw;
+    jumpCount     = 1;
+    return fault;
+  }
+
+  // disagreement along the direction of travel, positive when localization moved further
+  double along;
+  if (odomLength > fabs(odomDYaw) * POSITION_NOISE / YAW_NOISE)
+  {
+    along = (errorX * odomDX + errorY * odomDY) / odomLength / positionSigma;
+  }
+  else
+  {
+    along = (odomDYaw < 0 ? -errorYaw : errorYaw) / yawSigma;
+  }
+  along = std::min(SLIP_CLIP, std::max(-SLIP_CLIP, along));
+
+  slipHigh = std::max(0.0, slipHigh + along - SLIP_DRIFT);
+  slipLow  = std::max(0.0, slipLow  - along - SLIP_DRIFT);
+  if (slipHigh > SLIP_THRESHOLD || slipLow > SLIP_THRESHOLD) fault = MotionFault::Slip;
+
+  return fault;
+}
+
+/** @return the fault found since the last reset(), or None */
+MotionFault::Enum MotionMonitor::getFault() const
+{
+  return fault;
+}
+
+/**
+ * @return how sure the monitor is that something is wrong, between 0 and 1.
+ *         Reaches 1 when a fault is reported
+ */
+double MotionMonitor::getConfidence() const
+{
+  if (fault != MotionFault::None) return 1.0;
+
+  double slip = std::max(slipHigh, slipLow) / SLIP_THRESHOLD,
+         jump = (double)jumpCount / (JUMP_CONFIRM_COUNT + 1);
+
+  return std::min(1.0, std::max(slip, jump));
+}
+
+/** @return number of localization jumps that snapped back and were ignored */
+int MotionMonitor::getGlitchCount() const
+{
+  return glitchCount;
+}
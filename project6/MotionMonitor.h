@@ -0,0 +1,67 @@
+#ifndef MOTION_MONITOR_H
+#define MOTION_MONITOR_H
+#pragma once
+
+#include "Vector2.h"
+
+/**
+ * Ways the robot's motion can go wrong. Slip is a slow, steady disagreement
+ * between the wheels and localization, e.g. wheels spinning against a wall.
+ * Jump is localization suddenly moving the robot somewhere else and staying
+ * there, e.g. the robot being picked up and put down.
+ */
+namespace MotionFault
+{
+  enum Enum { None, Slip, Jump };
+}
+
+/**
+ * Watches how far the odometer and localization each say the robot moved
+ * and decides when they disagree by more than noise.
+ *
+ * The two are compared each time localization has a new estimate, and the
+ * disagreement is scaled by how noisy it is expected to be. Slip is found with
+ * a two sided CUSUM over the disagreement along the direction of travel, so
+ * small errors that keep pointing the same way add up while noise cancels out.
+ * A single large disagreement is only a jump if localization stays where it
+ * jumped to for a few more estimates; jumps that snap back are noise from
+ * localization and are ignored.
+ */
+class MotionMonitor
+{
+  // where each source put the robot as of the last estimate
+  Vector2 lastOdometerPos,
+          lastLocalizedPos;
+  double  lastOdometerYaw,
+          lastLocalizedYaw;
+
+  // CUSUMs of the disagreement along the direction of travel, in standard deviations
+  double slipHigh,  // localization moving further than the odometer
+         slipLow;   // localization moving less far than the odometer
+
+  // a jump waiting to be confirmed
+  Vector2 jumpOffset;    // how far localization jumped away from the odometer
+  double  jumpYawOffset; // how far localization turned away from the odometer
+  bool    isYawJump;     // true if the jump was more in yaw than in position
+  Vector2 offset;        // disagreement in position added up since the jump
+  double  yawOffset;     // disagreement in yaw added up since the jump
+  int     jumpCount;     // estimates localization has stayed jumped for, 0 if there is no jump
+
+  MotionFault::Enum fault;
+  int glitchCount; // jumps that snapped back
+
+public:
+  // constructor
+  MotionMonitor();
+
+  // tracking
+  void reset(Vector2 odometerPos, double odometerYaw, Vector2 localizedPos, double localizedYaw);
+  MotionFault::Enum update(Vector2 odometerPos, double odometerYaw, Vector2 localizedPos, double localizedYaw);
+
+  // results
+  MotionFault::Enum getFault() const;
+  double getConfidence() const;
+  int getGlitchCount() const;
+};
+
+#endif
@@ -0,0 +1,160 @@
+#include "MotionProfile.h"
+#include <algorithm> // std::min
+#include <cmath>     // fabs, sqrt
+
+// number of bisection steps used to find the peak velocity of short moves
+const int PEAK_SEARCH_STEPS = 50;
+
+/**
+ * Creates the fastest profile that covers the distance within the given limits
+ *
+ * @param distance        - distance to cover. Negative values move backwards
+ * @param maxVelocity     - velocity limit, in units per second
+ * @param maxAcceleration - acceleration limit, in units per second squared
+ * @param maxJerk         - jerk limit, in units per second cubed. 0 or less
+ *                          gives a trapezoidal profile
+ */
+MotionProfile::MotionProfile(double distance,
+                             double maxVelocity,
+                             double maxAcceleration,
+                             double maxJerk) :
+  distance(fabs(distance)),
+  direction(distance < 0 ? -1.0 : 1.0),
+  jerk(maxJerk > 0 ? maxJerk : 0)
+{
+  maxVelocity     = fabs(maxVelocity);
+  maxAcceleration = fabs(maxAcceleration);
+
+  setPeakVelocity(maxVelocity, maxAcceleration);
+
+  // too short to reach top velocity, find the peak velocity that turns around right at the halfway point
+  if (2.0 * rampDistance > this->distance)
+  {
+    double low = 0, high = maxVelocity;
+    for (int i = 0; i < PEAK_SEARCH_STEPS; i++)
+    {
+      setPeakVelocity((low + high) / 2.0, maxAcceleration);
+      if (2.0 * rampDistance > this->distance) high = peakVelocity;
+      else                                     low  = peakVelocity;
+    }
+    setPeakVelocity(low, maxAcceleration);
+  }
+
+  cruiseTime = peakVelocity > 0 ? (this->distance - 2.0 * rampDistance) / peakVelocity : 0;
+}
+
+/**
+ * Works out how long it takes to accelerate from rest up to the given velocity
+ *
+ * @param velocity        - velocity to accelerate up to
+ * @param maxAcceleration - acceleration limit
+ */
+void MotionProfile::setPeakVelocity(double velocity, double maxAcceleration)
+{
+  peakVelocity = velocity;
+
+  if (velocity <= 0 || maxAcceleration <= 0)
+  {
+    peakAcceleration = jerkTime = rampTime = rampDistance = 0;
+    return;
+  }
+
+  if (jerk > 0)
+  {
+    // the acceleration limit is only reached if there is enough velocity to ramp up to it and back down
+    peakAcceleration = std::min(maxAcceleration, sqrt(velocity * jerk));
+    jerkTime         = peakAcceleration / jerk;
+  }
+  else
+  {
+    peakAcceleration = maxAcceleration;
+    jerkTime         = 0;
+  }
+
+  // the ramp is symmetric so the average velocity over it is half the peak
+  rampTime     = velocity / peakAcceleration + jerkTime;
+  rampDistance = velocity * rampTime / 2.0;
+}
+
+/**
+ * @param t - time since starting to accelerate, between 0 and rampTime
+ * @return velocity at that time
+ */
+double MotionProfile::getRampVelocity(double t) const
+{
+  if (t <= 0)        return 0;
+  if (t >= rampTime) return peakVelocity;
+
+  // acceleration ramping up
+  if (t < jerkTime) return jerk * t * t / 2.0;
+
+  // acceleration ramping down
+  double s = rampTime - t;
+  if (s < jerkTime) return peakVelocity - jerk * s * s / 2.0;
+
+  // constant acceleration
+  return peakAcceleration * (t - jerkTime / 2.0);
+}
+
+/**
+ * @param t - time since starting to accelerate, between 0 and rampTime
+ * @return distance covered by that time
+ */
+double MotionProfile::getRampPosition(double t) const
+{
+  if (t <= 0)        return 0;
+  if (t >= rampTime) return rampDistance;
+
+  // acceleration ramping up
+  if (t < jerkTime) return jerk * t * t * t / 6.0;
+
+  // acceleration ramping down, worked out backwards from the end of the ramp
+  double s = rampTime - t;
+  if (s < jerkTime) return rampDistance - (peakVelocity * s - jerk * s * s * s / 6.0);
+
+  // constant acceleration
+  double u = t - jerkTime;
+  return jerk * jerkTime * jerkTime * jerkTime / 6.0 +
+         peakAcceleration * jerkTime / 2.0 * u +
+         peakAcceleration * u * u / 2.0;
+}
+
+/**
+ * @param t - time since the start of the move in seconds
+ * @return velocity the robot should be moving at
+ */
+double MotionProfile::getVelocity(double t) const
+{
+  double end = getDuration();
+
+  if (t < rampTime)              return direction * getRampVelocity(t);
+  if (t < rampTime + cruiseTime) return direction * peakVelocity;
+
+  return direction * getRampVelocity(end - t);
+}
+
+/**
+ * @param t - time since the start of the move in seconds
+ * @return distance the robot should have covered
+ */
+double MotionProfile::getPosition(double t) const
+{
+  double end = getDuration();
+
+  if (t < rampTime)              return direction * getRampPosition(t);
+  if (t < rampTime + cruiseTime) return direction * (rampDistance + peakVelocity * (t - rampTime));
+
+  return direction * (distance - getRampPosition(end - t));
+}
+
+/** @return time taken to complete the move in seconds */
+double MotionProfile::getDuration() const
+{
+  return 2.0 * rampTime + cruiseTime;
+}
+
+/** @return total distance covered, negative if moving backwards */
+double MotionProfile::getDistance() const
+{
+  return direction * distance;
+}
@@ -0,0 +1,46 @@
+#ifndef MOTION_PROFILE_H
+#define MOTION_PROFILE_H
+#pragma once
+
+/**
+ * Velocity over time for covering a set distance (or angle) in a single pass
+ * while keeping within velocity, acceleration and jerk limits.
+ *
+ * With no jerk limit this is a trapezoid: accelerate, cruise, decelerate. With
+ * a jerk limit the corners of the trapezoid are rounded off into an S-curve so
+ * the robot never lurches. Short moves that cannot reach top velocity skip the
+ * cruise and turn around at a lower peak velocity instead.
+ *
+ * Negative distances give a mirrored profile with negative velocities.
+ */
+class MotionProfile
+{
+  double distance,        // total distance to cover, always positive
+         direction,       // 1 or -1 depending on the sign of the given distance
+         peakVelocity,    // velocity reached at the end of accelerating
+         peakAcceleration,// acceleration reached while accelerating
+         jerk,            // rate of change of acceleration, or 0 for no limit
+         jerkTime,        // time spent ramping acceleration up or down
+         rampTime,        // time spent accelerating from rest to peakVelocity
+         rampDistance,    // distance covered while accelerating
+         cruiseTime;      // time spent at peakVelocity
+
+  void setPeakVelocity(double velocity, double maxAcceleration);
+  double getRampVelocity(double t) const;
+  double getRampPosition(double t) const;
+
+public:
+  // constructor
+  MotionProfile(double distance,
+                double maxVelocity,
+                double maxAcceleration,
+                double maxJerk = 0);
+
+  // following the profile
+  double getVelocity(double t) const;
+  double getPosition(double t) const;
+  double getDuration() const;
+  double getDistance() const;
+};
+
+#endif
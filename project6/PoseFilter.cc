@@ -0,0 +1,282 @@
+#include "PoseFilter.h"
+#include <algorithm> // std::max
+#include <cmath>     // atan2, cos, sin, hypot, fabs
+
+// noise the odometer adds to the pose, as a share of the motion since the last tick
+const double TRANSLATION_NOISE  = 0.05; // meters per meter moved
+const double ROTATION_NOISE     = 0.05; // radians per radian turned
+const double ROTATION_PER_METER = 0.02; // radians per meter moved
+
+// localization is never trusted more than this, as its estimates lag behind the robot
+const double MIN_POSITION_VARIANCE = 0.01;   // m^2, 0.1m standard deviation
+const double MIN_YAW_VARIANCE      = 0.0025; // rad^2, ~3 degree standard deviation
+
+const double GATE_THRESHOLD     = 16.27; // squared Mahalanobis distance of a believable estimate, 99.9% over 3 dimensions
+const int    REJECT_RESET_COUNT = 3;     // estimates in a row too far off before the filter starts over from them
+
+/**
+ * @param yaw - angle in radians
+ * @return the same angle between -PI and PI
+ */
+static double wrapAngle(double yaw)
+{
+  return atan2(sin(yaw), cos(yaw));
+}
+
+/**
+ * Multiplies two 3x3 matrices
+ *
+ * @param a      - left matrix
+ * @param b      - right matrix
+ * @param result - set to a * b. May not be a or b
+ */
+static void multiply(const double a[3][3], const double b[3][3], double result[3][3])
+{
+  for (int i = 0; i < 3; i++)
+  {
+    for (int j = 0; j < 3; j++)
+    {
+      result[i][j] = a[i][0] * b[0][j] + a[i][1] * b[1][j] + a[i][2] * b[2][j];
+    }
+  }
+}
+
+/**
+ * Inverts a 3x3 matrix
+ *
+ * @param m       - the matrix
+ * @param inverse - set to the inverse of m
+ * @return false if m cannot be inverted
+ */
+static bool invert(const double m[3][3], double inverse[3][3])
+{
+  double det = m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1]) -
+               m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0]) +
+               m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+
+  if (fabs(det) < 1e-12) return false;
+
+  inverse[0][0] =  (m[1][1] * m[2][2] - m[1][2] * m[2][1]) / det;
+  inverse[0][1] = -(m[0][1] * m[2][2] - m[0][2] * m[2][1]) / det;
+  inverse[0][2] =  (m[0][1] * m[1][2] - m[0][2] * m[1][1]) / det;
+  inverse[1][0] = -(m[1][0] * m[2][2] - m[1][2] * m[2][0]) / det;
+  inverse[1][1] =  (m[0][0] * m[2][2] - m[0][2] * m[2][0]) / det;
+  inverse[1][2] = -(m[0][0] * m[1][2] - m[0][2] * m[1][0]) / det;
+  inverse[2][0] =  (m[1][0] * m[2][1] - m[1][1] * m[2][0]) / det;
+  inverse[2][1] = -(m[0][0] * m[2][1] - m[0][1] * m[2][0]) / det;
+  inverse[2][2] =  (m[0][0] * m[1][1] - m[0][1] * m[1][0]) / det;
+
+  return true;
+}
+
+/** Creates a filter that has seen nothing yet */
+PoseFilter::PoseFilter() :
+  hasOdometer(false),
+  isLocalized(false),
+  lastOdometerYaw(0),
+  lastLocalizedYaw(0),
+  correctionCount(0)
+{
+  const double none[3] = { 0, 0, 0 };
+  reset(Vector2(), 0, none);
+}
+
+/**
+ * Starts the filter over from the given pose
+ *
+ * @param pos      - position in the map
+ * @param yaw      - yaw in the map
+ * @param variance - variance of x, y and yaw
+ */
+void PoseFilter::reset(Vector2 pos, double yaw, const double variance[3])
+{
+  x         = pos.x;
+  y         = pos.y;
+  this->yaw = wrapAngle(yaw);
+
+  for (int i = 0; i < 3; i++)
+  {
+    for (int j = 0; j < 3; j++) covariance[i][j] = i == j ? variance[i] : 0;
+  }
+
+  rejectCount = 0;
+}
+
+/**
+ * Moves the pose by however far the odometer moved since the last call and
+ * grows the covariance to match. Call once per read.
+ *
+ * @param odometerPos - position according to the odometer
+ * @param odometerYaw - yaw according to the odometer
+ */
+void PoseFilter::predict(Vector2 odometerPos, double odometerYaw)
+{
+  // the filter starts out wherever the odometer does
+  if (!hasOdometer)
+  {
+    hasOdometer     = true;
+    lastOdometerPos = odometerPos;
+    lastOdometerYaw = odometerYaw;
+    if (!isLocalized)
+    {
+      const double none[3] = { 0, 0, 0 };
+      reset(odometerPos, odometerYaw, none);
+    }
+    return;
+  }
+
+  // motion since the last call, relative to where the robot was facing
+  double dx      = odometerPos.x - lastOdometerPos.x,
+         dy      = odometerPos.y - lastOdometerPos.y,
+         c       = cos(lastOdometerYaw),
+         s       = sin(lastOdometerYaw),
+         forward =  c * dx + s * dy,
+         lateral = -s * dx + c * dy,
+         turn    = wrapAngle(odometerYaw - lastOdometerYaw);
+
+  lastOdometerPos = odometerPos;
+  lastOdometerYaw = odometerYaw;
+
+  // the same motion from where the filter has the robot facing
+  c = cos(yaw);
+  s = sin(yaw);
+  double moveX = forward * c - lateral * s,
+         moveY = forward * s + lateral * c;
+
+  x  += moveX;
+  y  += moveY;
+  yaw = wrapAngle(yaw + turn);
+
+  // covariance = F * covariance * F^T + Q, where F is the jacobian of the motion over the pose
+  double jacobian[3][3] = { { 1, 0, -moveY },
+                            { 0, 1,  moveX },
+                            { 0, 0,  1     } },
+         transpose[3][3] = { { 1,      0,     0 },
+                             { 0,      1,     0 },
+                             { -moveY, moveX, 1 } },
+         temp[3][3];
+
+  multiply(jacobian, covariance, temp);
+  multiply(temp, transpose, covariance);
+
+  double distance    = hypot(forward, lateral),
+         translation = TRANSLATION_NOISE * distance,
+         rotation    = ROTATION_NOISE * fabs(turn) + ROTATION_PER_METER * distance;
+
+  covariance[0][0] += translation * translation;
+  covariance[1][1] += translation * translation;
+  covariance[2][2] += rotation * rotation;
+}
+
+/**
+ * Pulls the pose towards a localization estimate. Estimates that are the same
+ * as the last one are not new and are ignored.
+ *
+ * @param localizedPos - position according to localization
+ * @param localizedYaw - yaw according to localization
+ * @param variance     - localization's variance of x, y and yaw
+ * @return true if the pose was corrected
+ */
+bool PoseFilter::correct(Vector2 localizedPos, double localizedYaw, const double variance[3])
+{
+  if (isLocalized && localizedPos == lastLocalizedPos && localizedYaw == lastLocalizedYaw) return false;
+
+  lastLocalizedPos = localizedPos;
+  lastLocalizedYaw = localizedYaw;
+
+  double noise[3] = { std::max(variance[0], MIN_POSITION_VARIANCE),
+                      std::max(variance[1], MIN_POSITION_VARIANCE),
+                      std::max(variance[2], MIN_YAW_VARIANCE) };
+
+  // the first estimate replaces wherever the odometer put the robot
+  if (!isLocalized)
+  {
+    isLocalized = true;
+    reset(localizedPos, localizedYaw, noise);
+    correctionCount++;
+    return true;
+  }
+
+  double innovation[3] = { localizedPos.x - x,
+                           localizedPos.y - y,
+                           wrapAngle(localizedYaw - yaw) },
+         innovationCovariance[3][3],
+         inverse[3][3];
+
+  for (int i = 0; i < 3; i++)
+  {
+    for (int j = 0; j < 3; j++) innovationCovariance[i][j] = covariance[i][j] + (i == j ? noise[i] : 0);
+  }
+
+  if (!invert(innovationCovariance, inverse)) return false;
+
+  // skip estimates too far off to be believed, unless localization keeps insisting
+  double distance = 0;
+  for (int i = 0; i < 3; i++)
+  {
+    for (int j = 0; j < 3; j++) distance += innovation[i] * inverse[i][j] * innovation[j];
+  }
+
+  if (distance > GATE_THRESHOLD)
+  {
+    if (++rejectCount < REJECT_RESET_COUNT) return false;
+
+    reset(localizedPos, localizedYaw, noise);
+    correctionCount++;
+    return true;
+  }
+  rejectCount = 0;
+
+  // gain = covariance * inverse
+  double gain[3][3], temp[3][3];
+  multiply(covariance, inverse, gain);
+
+  x  += gain[0][0] * innovation[0] + gain[0][1] * innovation[1] + gain[0][2] * innovation[2];
+  y  += gain[1][0] * innovation[0] + gain[1][1] * innovation[1] + gain[1][2] * innovation[2];
+  yaw = wrapAngle(yaw + gain[2][0] * innovation[0] + gain[2][1] * innovation[1] + gain[2][2] * innovation[2]);
+
+  // covariance = (I - gain) * covariance, kept symmetric against rounding
+  for (int i = 0; i < 3; i++)
+  {
+    for (int j = 0; j < 3; j++) temp[i][j] = (i == j ? 1 : 0) - gain[i][j];
+  }
+  double updated[3][3];
+  multiply(temp, covariance, updated);
+
+  for (int i = 0; i < 3; i++)
+  {
+    for (int j = 0; j < 3; j++) covariance[i][j] = (updated[i][j] + updated[j][i]) / 2.0;
+  }
+
+  correctionCount++;
+  return true;
+}
+
+/** @return fused position in the map */
+Vector2 PoseFilter::getPos() const
+{
+  return Vector2(x, y);
+}
+
+/** @return fused yaw in the map, between -PI and PI */
+double PoseFilter::getYaw() const
+{
+  return yaw;
+}
+
+/**
+ * @param covariance - set to the covariance of x, y and yaw
+ */
+void PoseFilter::getCovariance(double covariance[3][3]) const
+{
+  for (int i = 0; i < 3; i++)
+  {
+    for (int j = 0; j < 3; j++) covariance[i][j] = this->covariance[i][j];
+  }
+}
+
+/** @return number of localization estimates the pose was pulled towards */
+unsigned long PoseFilter::getCorrectionCount() const
+{
+  return correctionCount;
+}
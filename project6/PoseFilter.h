@@ -0,0 +1,55 @@
+#ifndef POSE_FILTER_H
+#define POSE_FILTER_H
+#pragma once
+
+#include "Vector2.h"
+
+/**
+ * Extended Kalman filter over the robot's pose (x, y, yaw) in the map.
+ *
+ * Every tick the pose is moved by however far the odometer says the robot
+ * moved since the last tick, and the covariance grows with the distance and
+ * angle moved. Whenever localization has a new estimate the pose is pulled
+ * towards it, weighted by how sure each of them is. The result follows the
+ * odometer's smooth motion between estimates without drifting away from the
+ * map, and without the lag of waiting for localization's next estimate.
+ *
+ * Until localization gives its first estimate the filter simply follows the
+ * odometer.
+ *
+ * Estimates further off than noise allows are skipped, so a single jump from
+ * localization does not yank the pose away. If localization stays somewhere
+ * else for a few estimates in a row the filter starts over from it, as the
+ * robot has most likely been moved.
+ */
+class PoseFilter
+{
+  double x, y, yaw;
+  double covariance[3][3]; // of x, y and yaw
+
+  bool          hasOdometer;      // true once the odometer has been seen
+  bool          isLocalized;      // true once localization has given an estimate
+  Vector2       lastOdometerPos;  // odometer pose as of the last prediction
+  double        lastOdometerYaw;
+  Vector2       lastLocalizedPos; // localization estimate as of the last correction
+  double        lastLocalizedYaw;
+  int           rejectCount;      // estimates skipped in a row for being too far off
+  unsigned long correctionCount;  // estimates the pose was pulled towards
+
+public:
+  // constructor
+  PoseFilter();
+
+  // tracking
+  void reset(Vector2 pos, double yaw, const double variance[3]);
+  void predict(Vector2 odometerPos, double odometerYaw);
+  bool correct(Vector2 localizedPos, double localizedYaw, const double variance[3]);
+
+  // results
+  Vector2 getPos() const;
+  double getYaw() const;
+  void getCovariance(double covariance[3][3]) const;
+  unsigned long getCorrectionCount() const;
+};
+
+#endif
@@ -0,0 +1,206 @@
+#include "PosePredictor.h"
+#include <algorithm> // std::min, std::max
+#include <cmath>     // atan2, cos, sin, fabs
+
+const double LATENCY_SMOOTHING = 0.2; // weight of each new latency measurement
+const double MAX_LATENCY       = 2.0; // longest latency believed in seconds, anything more is a clock hiccup
+
+/**
+ * @param yaw - angle in radians
+ * @return the same angle between -PI and PI
+ */
+static double wrapAngle(double yaw)
+{
+  return atan2(sin(yaw), cos(yaw));
+}
+
+/**
+ * Moves a pose by a motion measured relative to where the robot was facing
+ *
+ * @param forward - distance moved in the direction the robot was facing
+ * @param lateral - distance moved to the left of it
+ * @param turn    - angle turned
+ * @param pos     - the position to move
+ * @param yaw     - the yaw to move
+ */
+static void applyMotion(double forward, double lateral, double turn, Vector2& pos, double& yaw)
+{
+  double c = cos(yaw),
+         s = sin(yaw);
+
+  pos.x += forward * c - lateral * s;
+  pos.y += forward * s + lateral * c;
+  yaw    = wrapAngle(yaw + turn);
+}
+
+/** Creates a predictor that has seen nothing yet */
+PosePredictor::PosePredictor() :
+  newestOdometry(-1),
+  odometryCount(0),
+  newestCommand(-1),
+  commandCount(0),
+  localizationLatency(0) {}
+
+/**
+ * Keeps the odometer's pose as of a snapshot. Call once per snapshot
+ *
+ * @param time - monotonic time the snapshot was taken at in seconds
+ * @param pos  - position according to the odometer
+ * @param yaw  - yaw according to the odometer
+ */
+void PosePredictor::addOdometry(double time, Vector2 pos, double yaw)
+{
+  newestOdometry = (newestOdometry + 1) % SAMPLE_COUNT;
+  odometryCount  = std::min(odometryCount + 1, SAMPLE_COUNT);
+
+  odometry[newestOdometry].time = time;
+  odometry[newestOdometry].pos  = pos;
+  odometry[newestOdometry].yaw  = yaw;
+}
+
+/**
+ * Works out where the odometer had the robot at the given time, between the
+ * samples either side of it
+ *
+ * @param time - monotonic time in seconds. Clamped to the samples kept
+ * @param pos  - set to the odometer's position at that time
+ * @param yaw  - set to the odometer's yaw at that time
+ * @return false if there are no samples
+ */
+bool PosePredictor::getOdometryAt(double time, Vector2& pos, double& yaw) const
+{
+  if (odometryCount == 0) return false;
+
+  // walk back from the newest sample until one is no newer than the time
+  int newer = newestOdometry;
+  for (int i = 1; i < odometryCount; i++)
+  {
+    int older = (newestOdometry - i + SAMPLE_COUNT) % SAMPLE_COUNT;
+
+    if (odometry[older].time <= time)
+    {
+      const OdometrySample& a = odometry[older];
+      const OdometrySample& b = odometry[newer];
+      double t = b.time > a.time ? std::min(1.0, (time - a.time) / (b.time - a.time)) : 1.0;
+
+      pos = Vector2(a.pos.x + (b.pos.x - a.pos.x) * t, a.pos.y + (b.pos.y - a.pos.y) * t);
+      yaw = wrapAngle(a.yaw + wrapAngle(b.yaw - a.yaw) * t);
+      return true;
+    }
+    newer = older;
+  }
+
+  // older than anything kept, or newer than everything
+  const OdometrySample& sample = odometry[time < odometry[newer].time ? newer : newestOdometry];
+  pos = sample.pos;
+  yaw = sample.yaw;
+  return true;
+}
+
+/**
+ * Takes in how old a localization estimate was when it arrived
+ *
+ * @param latency - age of the estimate in seconds
+ */
+void PosePredictor::addLocalizationLatency(double latency)
+{
+  if (latency < 0 || latency > MAX_LATENCY) return;
+
+  localizationLatency += LATENCY_SMOOTHING * (latency - localizationLatency);
+}
+
+/** @return smoothed age of localization's estimates when they arrive, in seconds */
+double PosePredictor::getLocalizationLatency() const
+{
+  return localizationLatency;
+}
+
+/**
+ * Brings a pose estimated for an earlier time up to date by however far the
+ * odometer says the robot moved since
+ *
+ * @param estimateTime - monotonic time the pose was estimated for in seconds
+ * @param time         - monotonic time to bring the pose up to in seconds
+ * @param pos          - the position to move
+ * @param yaw          - the yaw to move
+ */
+void PosePredictor::compensate(double estimateTime, double time, Vector2& pos, double& yaw) const
+{
+  Vector2 thenPos, nowPos;
+  double  thenYaw, nowYaw;
+
+  if (!getOdometryAt(estimateTime, thenPos, thenYaw) || !getOdometryAt(time, nowPos, nowYaw)) return;
+
+  // motion since then, relative to where the odometer had the robot facing
+  double dx = nowPos.x - thenPos.x,
+         dy = nowPos.y - thenPos.y,
+         c  = cos(thenYaw),
+         s  = sin(thenYaw);
+
+  applyMotion(c * dx + s * dy, -s * dx + c * dy, wrapAngle(nowYaw - thenYaw), pos, yaw);
+}
+
+/**
+ * Keeps a command the robot was sent
+ *
+ * @param time            - monotonic time the command was sent at in seconds
+ * @param forwardVelocity - m/s the robot should really move at
+ * @param angularVelocity - rad/s the robot should really turn at
+ */
+void PosePredictor::addCommand(double time, double forwardVelocity, double angularVelocity)
+{
+  newestCommand = (newestCommand + 1) % SAMPLE_COUNT;
+  commandCount  = std::min(commandCount + 1, SAMPLE_COUNT);
+
+  commands[newestCommand].time            = time;
+  commands[newestCommand].forwardVelocity = forwardVelocity;
+  commands[newestCommand].angularVelocity = angularVelocity;
+}
+
+/**
+ * Moves a pose along by the commands the robot was following between two
+ * times, each one driving the robot along an arc until the next was sent
+ *
+ * @param fromTime - monotonic time the pose is for in seconds
+ * @param toTime   - monotonic time to move the pose up to in seconds
+ * @param pos      - the position to move
+ * @param yaw      - the yaw to move
+ */
+void PosePredictor::predict(double fromTime, double toTime, Vector2& pos, double& yaw) const
+{
+  if (commandCount == 0 || toTime <= fromTime) return;
+
+  // find the oldest command still in force at fromTime
+  int first = newestCommand,
+      i     = 1;
+  for (; i < commandCount && commands[first].time > fromTime; i++)
+  {
+    first = (newestCommand - i + SAMPLE_COUNT) % SAMPLE_COUNT;
+  }
+
+  // follow each command from when it took over until the next one did
+  for (int index = first; ; index = (index + 1) % SAMPLE_COUNT)
+  {
+    const CommandSample& command = commands[index];
+    bool   isNewest = index == newestCommand;
+    double start    = std::max(fromTime, command.time),
+           end      = isNewest ? toTime : std::min(toTime, commands[(index + 1) % SAMPLE_COUNT].time),
+           dt       = end - start;
+
+    if (dt > 0)
+    {
+      double turn = command.angularVelocity * dt,
+             arc  = command.forwardVelocity * dt;
+
+      // along the chord of the arc, relative to where the robot was facing
+      if (fabs(turn) < 1e-9) applyMotion(arc, 0, 0, pos, yaw);
+      else
+      {
+        double radius = arc / turn;
+        applyMotion(radius * sin(turn), radius * (1 - cos(turn)), turn, pos, yaw);
+      }
+    }
+
+    if (isNewest || end >= toTime) break;
+  }
+}
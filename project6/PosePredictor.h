@@ -0,0 +1,70 @@
+#ifndef POSE_PREDICTOR_H
+#define POSE_PREDICTOR_H
+#pragma once
+
+#include "Vector2.h"
+
+/**
+ * Where the odometer had the robot at a moment in time
+ */
+struct OdometrySample
+{
+  double  time; // monotonic time in seconds
+  Vector2 pos;
+  double  yaw;
+};
+
+/**
+ * A velocity the robot was told to move at, from the moment it was sent until
+ * the next one
+ */
+struct CommandSample
+{
+  double time;            // monotonic time in seconds
+  double forwardVelocity, // m/s the robot should really move at
+         angularVelocity; // rad/s the robot should really turn at
+};
+
+/**
+ * Keeps the last few seconds of odometry and commands so that poses which are
+ * already stale by the time they are used can be brought up to date.
+ *
+ * Localization works off of data that is a while old by the time its estimate
+ * arrives, so compensate() moves an estimate along by however far the odometer
+ * says the robot went since. Every snapshot is older still by the time the
+ * robot acts on it, so predict() moves a pose along by the commands the robot
+ * has been following since the snapshot was taken.
+ *
+ * The odometry half is only used by the thread that captures snapshots and the
+ * command half by the thread that drives, so the two never need a lock.
+ */
+class PosePredictor
+{
+  static const int SAMPLE_COUNT = 64; // samples of each kind kept, a few seconds at the tick rate
+
+  OdometrySample odometry[SAMPLE_COUNT];
+  int            newestOdometry, // index of the newest sample
+                 odometryCount;  // number of samples kept so far
+  CommandSample  commands[SAMPLE_COUNT];
+  int            newestCommand,
+                 commandCount;
+  double         localizationLatency; // smoothed age of localization's estimates in seconds
+
+  bool getOdometryAt(double time, Vector2& pos, double& yaw) const;
+
+public:
+  // constructor
+  PosePredictor();
+
+  // odometry
+  void addOdometry(double time, Vector2 pos, double yaw);
+  void addLocalizationLatency(double latency);
+  double getLocalizationLatency() const;
+  void compensate(double estimateTime, double time, Vector2& pos, double& yaw) const;
+
+  // commands
+  void addCommand(double time, double forwardVelocity, double angularVelocity);
+  void predict(double fromTime, double toTime, Vector2& pos, double& yaw) const;
+};
+
+#endif
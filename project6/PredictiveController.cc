@@ -0,0 +1,326 @@
+#include "PredictiveController.h"
+#include <algorithm> // std::min, std::max
+#include <chrono>    // std::chrono::steady_clock
+#include <cmath>     // cos, sin, sqrt
+
+const double SAFE_DISTANCE    = 0.5;  // meters from an obstacle the robot starts paying for being close
+const double VELOCITY_NOISE   = 2.0;  // standard deviation of the change in velocity each step, in steps of full acceleration
+const double ANGULAR_NOISE    = 2.0;  // same again for the angular velocity
+
+// how much each part of the cost counts for
+const double TRACKING_WEIGHT  = 1.0;   // per square meter away from the reference, each step
+const double OBSTACLE_WEIGHT  = 20.0;  // per square meter inside the safe distance, each step
+const double COLLISION_COST   = 1e6;   // for each step spent touching an obstacle
+const double EFFORT_WEIGHT    = 0.05;  // per square m/s or rad/s of change between steps
+
+/**
+ * Moves every rollout on by one step and adds up how far each strays from the
+ * reference. Each rollout moves along its heading, then its heading is turned
+ * by the step's rotation. Kept apart from rollOut() with every array marked
+ * __restrict, so the compiler knows none of them overlap and vectorizes the
+ * loop across candidates.
+ *
+ * @param n       - number of candidates
+ * @param dt      - seconds in the step
+ * @param v       - forward velocity of each candidate this step
+ * @param turnCos - cosine of the turn each candidate makes this step
+ * @param turnSin - sine of the same
+ * @param targetX - x coordinate the robot should be at after the step
+ * @param targetY - y coordinate the robot should be at after the step
+ * @param x       - x coordinate of each rollout
+ * @param y       - y coordinate of each rollout
+ * @param yawCos  - cosine of the heading of each rollout
+ * @param yawSin  - sine of the same
+ * @param cost    - cost of each rollout so far
+ */
+static void stepKinematics(int n, double dt,
+                           const double *__restrict v,
+                           const double *__restrict turnCos,
+                           const double *__restrict turnSin,
+                           double targetX, double targetY,
+                           double *__restrict x,
+                           double *__restrict y,
+                           double *__restrict yawCos,
+                           double *__restrict yawSin,
+                           double *__restrict cost)
+{
+  for (int k = 0; k < n; k++)
+  {
+    double c = yawCos[k],
+           s = yawSin[k];
+
+    x[k]      += v[k] * c * dt;
+    y[k]      += v[k] * s * dt;
+    yawCos[k]  = c * turnCos[k] - s * turnSin[k];
+    yawSin[k]  = s * turnCos[k] + c * turnSin[k];
+
+    double dx = x[k] - targetX,
+           dy = y[k] - targetY;
+    cost[k] += TRACKING_WEIGHT * (dx * dx + dy * dy);
+  }
+}
+
+/**
+ * Creates a new controller for a robot with the given limits
+ *
+ * @param maxVelocity            - forward velocity limit in m/s
+ * @param maxAngularVelocity     - angular velocity limit in rad/s
+ * @param maxAcceleration        - forward acceleration limit in m/s^2
+ * @param maxAngularAcceleration - angular acceleration limit in rad/s^2
+ * @param stepTime               - seconds between steps of a rollout, normally the tick interval
+ * @param candidateCount         - number of rollouts each tick
+ * @param robotRadius            - radius of the robot in meters
+ */
+PredictiveController::PredictiveController(double maxVelocity,
+                                           double maxAngularVelocity,
+                                           double maxAcceleration,
+                                           double maxAngularAcceleration,
+                                           double stepTime,
+                                           int    candidateCount,
+                                           double robotRadius) :
+  maxVelocity(maxVelocity),
+  maxAngularVelocity(maxAngularVelocity),
+  maxAcceleration(maxAcceleration),
+  maxAngularAcceleration(maxAngularAcceleration),
+  stepTime(stepTime),
+  robotRadius(robotRadius),
+  candidateCount(std::max(2, candidateCount)),
+  controlV(HORIZON * this->candidateCount),
+  controlW(HORIZON * this->candidateCount),
+  turnCos(HORIZON * this->candidateCount),
+  turnSin(HORIZON * this->candidateCount),
+  x(this->candidateCount),
+  y(this->candidateCount),
+  yawCos(this->candidateCount),
+  yawSin(this->candidateCount),
+  cost(this->candidateCount),
+  clearanceSqr(this->candidateCount),
+  bestV(HORIZON, 0),
+  bestW(HORIZON, 0),
+  rolloutCount(0),
+  rolloutSeconds(0) {}
+
+/**
+ * Takes in the latest laser scan. Only beams that hit something within reach
+ * of a rollout are kept.
+ *
+ * @param ranges   - distance measured by each beam in meters
+ * @param bearings - angle of each beam relative to the robot in radians
+ * @param maxRange - maximum range of the laser in meters
+ */
+void PredictiveController::setScan(const std::vector<double>& ranges,
+                                   const std::vector<double>& bearings,
+                                   double maxRange)
+{
+  double reach = maxVelocity * stepTime * HORIZON + SAFE_DISTANCE;
+
+  obstacleX.clear();
+  obstacleY.clear();
+
+  for (int i = 0; i < (int)ranges.size(); i++)
+  {
+    if (ranges[i] >= maxRange || ranges[i] > reach) continue;
+
+    obstacleX.push_back(ranges[i] * cos(bearings[i]));
+    obstacleY.push_back(ranges[i] * sin(bearings[i]));
+  }
+}
+
+/**
+ * Changes the time between steps of a rollout, e.g. to the measured length of
+ * the last tick when the loop is running late
+ *
+ * @param stepTime - seconds between steps
+ */
+void PredictiveController::setStepTime(double stepTime)
+{
+  if (stepTime > 0) this->stepTime = stepTime;
+}
+
+/** Forgets the best sequence from the last tick, e.g. after the robot was moved by something else */
+void PredictiveController::reset()
+{
+  std::fill(bestV.begin(), bestV.end(), 0.0);
+  std::fill(bestW.begin(), bestW.end(), 0.0);
+}
+
+/**
+ * Fills in the commands of every candidate. The first candidate is the best
+ * sequence from the last tick moved on by a step, the second brakes as hard
+ * as it can, and the rest add noise to the first. Every candidate stays
+ * within the velocity and acceleration limits. The turn each command makes
+ * over a step is kept as a rotation for rollOut().
+ *
+ * @param velocity        - current forward velocity in m/s
+ * @param angularVelocity - current angular velocity in rad/s
+ */
+void PredictiveController::sampleControls(double velocity, double angularVelocity)
+{
+  double stepV = maxAcceleration        * stepTime,
+         stepW = maxAngularAcceleration * stepTime;
+
+  std::normal_distribution<double> noiseV(0.0, VELOCITY_NOISE * stepV),
+                                   noiseW(0.0, ANGULAR_NOISE  * stepW);
+
+  for (int k = 0; k < candidateCount; k++)
+  {
+    double v = velocity,
+           w = angularVelocity;
+
+    for (int t = 0; t < HORIZON; t++)
+    {
+      // what the last tick wanted for this step, the last step is held
+      double wantV = bestV[std::min(t + 1, HORIZON - 1)],
+             wantW = bestW[std::min(t + 1, HORIZON - 1)];
+
+      if (k == 1)
+      {
+        wantV = 0;
+        wantW = 0;
+      }
+      else if (k > 1)
+      {
+        wantV += noiseV(random);
+        wantW += noiseW(random);
+      }
+
+      v = std::min(maxVelocity,        std::max(0.0,                 std::min(v + stepV, std::max(v - stepV, wantV))));
+      w = std::min(maxAngularVelocity, std::max(-maxAngularVelocity, std::min(w + stepW, std::max(w - stepW, wantW))));
+
+      controlV[t * candidateCount + k] = v;
+      controlW[t * candidateCount + k] = w;
+      turnCos[t * candidateCount + k]  = cos(w * stepTime);
+      turnSin[t * candidateCount + k]  = sin(w * stepTime);
+    }
+  }
+}
+
+/**
+ * Drives every candidate along its commands and adds up its cost
+ *
+ * @param velocity        - current forward velocity in m/s
+ * @param angularVelocity - current angular velocity in rad/s
+ * @param reference       - where the robot should be after each step, in the robot's frame
+ */
+void PredictiveController::rollOut(double velocity, double angularVelocity, const std::vector<Vector2>& reference)
+{
+  const int n = candidateCount;
+  double *px = &x[0], *py = &y[0], *pcos = &yawCos[0], *psin = &yawSin[0], *pcost = &cost[0], *pclear = &clearanceSqr[0];
+
+  // every rollout starts at the robot, facing straight ahead
+  std::fill(x.begin(),      x.end(),      0.0);
+  std::fill(y.begin(),      y.end(),      0.0);
+  std::fill(yawCos.begin(), yawCos.end(), 1.0);
+  std::fill(yawSin.begin(), yawSin.end(), 0.0);
+  std::fill(cost.begin(),   cost.end(),   0.0);
+
+  const double dt           = stepTime,
+               safeSqr      = SAFE_DISTANCE * SAFE_DISTANCE,
+               collisionSqr = robotRadius   * robotRadius;
+
+  for (int t = 0; t < HORIZON; t++)
+  {
+    const double *v  = &controlV[t * n],
+                 *w  = &controlW[t * n],
+                 *tc = &turnCos[t * n],
+                 *ts = &turnSin[t * n];
+    Vector2 target   = reference[std::min(t, (int)reference.size() - 1)];
+
+    stepKinematics(n, dt, v, tc, ts, target.x, target.y, px, py, pcos, psin, pcost);
+
+    // control effort, as the change from the step before
+    if (t == 0)
+    {
+      for (int k = 0; k < n; k++)
+      {
+        double dv = v[k] - velocity,
+               dw = w[k] - angularVelocity;
+        pcost[k] += EFFORT_WEIGHT * (dv * dv + dw * dw);
+      }
+    }
+    else
+    {
+      const double *lastV = v - n,
+                   *lastW = w - n;
+      for (int k = 0; k < n; k++)
+      {
+        double dv = v[k] - lastV[k],
+               dw = w[k] - lastW[k];
+        pcost[k] += EFFORT_WEIGHT * (dv * dv + dw * dw);
+      }
+    }
+
+    // distance to the closest obstacle, one obstacle at a time across every candidate
+    std::fill(clearanceSqr.begin(), clearanceSqr.end(), safeSqr);
+    for (int j = 0; j < (int)obstacleX.size(); j++)
+    {
+      double ox = obstacleX[j],
+             oy = obstacleY[j];
+      for (int k = 0; k < n; k++)
+      {
+        double dx = px[k] - ox,
+               dy = py[k] - oy;
+        pclear[k] = std::min(pclear[k], dx * dx + dy * dy);
+      }
+    }
+
+    for (int k = 0; k < n; k++)
+    {
+      double gap = SAFE_DISTANCE - sqrt(pclear[k]);
+      pcost[k] += OBSTACLE_WEIGHT * gap * gap +
+                  (pclear[k] < collisionSqr ? COLLISION_COST : 0.0);
+    }
+  }
+}
+
+/**
+ * Picks the first command of the cheapest candidate sequence
+ *
+ * @param velocity            - current forward velocity in m/s
+ * @param angularVelocity     - current angular velocity in rad/s
+ * @param reference           - where the robot should be after each step, in the robot's frame
+ * @param bestVelocity        - set to the forward velocity to send
+ * @param bestAngularVelocity - set to the angular velocity to send
+ * @return true if the best sequence stays clear of every obstacle. The command
+ *         is set either way, but the robot should stop when this is false
+ */
+bool PredictiveController::getCommand(double velocity,
+                                      double angularVelocity,
+                                      const std::vector<Vector2>& reference,
+                                      double& bestVelocity,
+                                      double& bestAngularVelocity)
+{
+  if (reference.empty()) return false;
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  sampleControls(velocity, angularVelocity);
+  rollOut(velocity, angularVelocity, reference);
+
+  int best = 0;
+  for (int k = 1; k < candidateCount; k++)
+  {
+    if (cost[k] < cost[best]) best = k;
+  }
+
+  // the next tick starts from this sequence
+  for (int t = 0; t < HORIZON; t++)
+  {
+    bestV[t] = controlV[t * candidateCount + best];
+    bestW[t] = controlW[t * candidateCount + best];
+  }
+
+  bestVelocity        = bestV[0];
+  bestAngularVelocity = bestW[0];
+
+  rolloutCount   += candidateCount;
+  rolloutSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  return cost[best] < COLLISION_COST;
+}
+
+/** @return average number of candidates rolled out per millisecond, or 0 before the first tick */
+double PredictiveController::getRolloutsPerMillisecond() const
+{
+  return rolloutSeconds > 0 ? rolloutCount / (rolloutSeconds * 1e3) : 0;
+}
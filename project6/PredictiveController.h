@@ -0,0 +1,94 @@
+#ifndef PREDICTIVE_CONTROLLER_H
+#define PREDICTIVE_CONTROLLER_H
+#pragma once
+
+#include <random>
+#include <vector>
+#include "Vector2.h"
+
+/**
+ * Sampling based model predictive controller. Each tick it makes a few hundred
+ * candidate sequences of forward and angular velocities by adding noise to the
+ * best sequence from the last tick, drives a unicycle model along every one of
+ * them for the whole horizon, and scores each for how far it strays from the
+ * reference, how close it comes to the latest laser scan and how hard it works
+ * the motors. Only the first command of the best sequence is sent.
+ *
+ * Rollouts are kept as a structure of arrays with one entry per candidate and
+ * each step of the model is a branch free loop over every candidate, so the
+ * compiler can vectorize the kinematics and the distance checks. Headings are
+ * kept as their cosine and sine and turned by a rotation worked out once per
+ * command in sampleControls(), as calls to cos() and sin() would stop the
+ * kinematics from vectorizing. The build compiles this file with -O3 and
+ * -fno-math-errno for the same reason.
+ *
+ * Everything is worked out in the robot's frame: x is straight ahead and y is
+ * to the left.
+ */
+class PredictiveController
+{
+  double maxVelocity,            // m/s
+         maxAngularVelocity,     // rad/s
+         maxAcceleration,        // m/s^2
+         maxAngularAcceleration, // rad/s^2
+         stepTime,               // seconds between steps of a rollout
+         robotRadius;            // m
+  int    candidateCount;         // rollouts per tick
+
+  // end points of the beams that hit something, in the robot's frame
+  std::vector<double> obstacleX,
+                      obstacleY;
+
+  // commands of every candidate, HORIZON rows of candidateCount
+  std::vector<double> controlV,
+                      controlW,
+                      turnCos,  // cosine of the turn over one step of each command
+                      turnSin;  // sine of the same
+
+  // state of every rollout, one per candidate
+  std::vector<double> x, y, yawCos, yawSin, cost, clearanceSqr;
+
+  // best sequence from the last tick, the next tick starts from it
+  std::vector<double> bestV,
+                      bestW;
+
+  std::mt19937 random;
+
+  // throughput
+  unsigned long rolloutCount;
+  double        rolloutSeconds;
+
+  void sampleControls(double velocity, double angularVelocity);
+  void rollOut(double velocity, double angularVelocity, const std::vector<Vector2>& reference);
+
+public:
+  static const int HORIZON = 20; // steps in each rollout
+
+  // constructor
+  PredictiveController(double maxVelocity,
+                       double maxAngularVelocity,
+                       double maxAcceleration,
+                       double maxAngularAcceleration,
+                       double stepTime,
+                       int    candidateCount = 256,
+                       double robotRadius    = 0.2);
+
+  // inputs
+  void setScan(const std::vector<double>& ranges,
+               const std::vector<double>& bearings,
+               double maxRange);
+  void setStepTime(double stepTime);
+  void reset();
+
+  // planning
+  bool getCommand(double velocity,
+                  double angularVelocity,
+                  const std::vector<Vector2>& reference,
+                  double& bestVelocity,
+                  double& bestAngularVelocity);
+
+  // throughput
+  double getRolloutsPerMillisecond() const;
+};
+
+#endif
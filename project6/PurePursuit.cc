@@ -0,0 +1,202 @@
+#include "PurePursuit.h"
+#include <algorithm> // std::min, std::max
+#include <cmath>     // atan2, cos, sin, fabs, hypot
+
+/**
+ * Creates a new tracker for the given path
+ *
+ * @param path          - points to follow in order. The first should be where the robot starts
+ * @param minLookahead  - shortest lookahead distance in meters
+ * @param maxLookahead  - longest lookahead distance in meters
+ * @param lookaheadGain - seconds of travel to look ahead by at the current speed
+ */
+PurePursuit::PurePursuit(const std::vector<Vector2>& path,
+                         double minLookahead,
+                         double maxLookahead,
+                         double lookaheadGain) :
+  path(path),
+  segment(0),
+  minLookahead(minLookahead),
+  maxLookahead(maxLookahead),
+  lookaheadGain(lookaheadGain),
+  lookaheadBearing(0) {}
+
+/**
+ * @param index - index of the first point of the segment
+ * @return length of the segment in meters, or 0 past the end of the path
+ */
+double PurePursuit::getSegmentLength(int index) const
+{
+  if (index + 1 >= (int)path.size()) return 0;
+
+  return hypot(path[index + 1].x - path[index].x, path[index + 1].y - path[index].y);
+}
+
+/**
+ * Projects a position onto a segment
+ *
+ * @param index - index of the first point of the segment
+ * @param pos   - position to project
+ * @return how far along the segment the closest point is, between 0 and 1
+ */
+double PurePursuit::getSegmentProgress(int index, Vector2 pos) const
+{
+  double length = getSegmentLength(index);
+  if (length <= 0) return 0;
+
+  const Vector2& a = path[index];
+  const Vector2& b = path[index + 1];
+
+  double t = ((pos.x - a.x) * (b.x - a.x) + (pos.y - a.y) * (b.y - a.y)) / (length * length);
+  return std::min(1.0, std::max(0.0, t));
+}
+
+/**
+ * @param index - index of the first point of the segment
+ * @param t     - how far along the segment, between 0 and 1
+ * @return the point that far along the segment
+ */
+Vector2 PurePursuit::getPointOnSegment(int index, double t) const
+{
+  if (index + 1 >= (int)path.size()) return path.back();
+
+  const Vector2& a = path[index];
+  const Vector2& b = path[index + 1];
+
+  return Vector2(a.x + (b.x - a.x) * t, a.y + (b.y - a.y) * t);
+}
+
+/**
+ * Moves on to the closest segment to the robot. Only segments within reach of
+ * the longest lookahead are checked and the robot never moves backwards along
+ * the path, so a path that doubles back on itself is still followed in order.
+ *
+ * @param pos - position of the robot
+ */
+void PurePursuit::updateClosestSegment(Vector2 pos)
+{
+  int    closest   = segment;
+  double bestDist  = -1,
+         travelled = -getSegmentLength(segment) * getSegmentProgress(segment, pos);
+
+  for (int i = segment; i + 1 < (int)path.size() && travelled <= 2.0 * maxLookahead; i++)
+  {
+    Vector2 p = getPointOnSegment(i, getSegmentProgress(i, pos));
+    double dist = hypot(pos.x - p.x, pos.y - p.y);
+
+    if (bestDist < 0 || dist < bestDist)
+    {
+      bestDist = dist;
+      closest  = i;
+    }
+
+    travelled += getSegmentLength(i);
+  }
+
+  segment = closest;
+}
+
+/**
+ * @param speed - current forward speed in m/s
+ * @return distance to look ahead by in meters
+ */
+double PurePursuit::getLookaheadDistance(double speed) const
+{
+  return std::min(maxLookahead, std::max(minLookahead, lookaheadGain * fabs(speed)));
+}
+
+/**
+ * Finds the curvature of the arc from the robot to the lookahead point. Setting
+ * the angular velocity to the forward velocity times the curvature makes the
+ * robot drive along that arc.
+ *
+ * @param pos   - position of the robot
+ * @param yaw   - yaw rotation of the robot in radians
+ * @param speed - current forward speed in m/s, used to pick the lookahead distance
+ * @return curvature in 1/m. Positive values turn counter-clockwise
+ */
+double PurePursuit::getCurvature(Vector2 pos, double yaw, double speed)
+{
+  updateClosestSegment(pos);
+  lookaheadPoint = getPointAhead(pos, getLookaheadDistance(speed));
+
+  // forward and sideways offset of the lookahead point from the robot's point of view
+  double dx      = lookaheadPoint.x - pos.x,
+         dy      = lookaheadPoint.y - pos.y,
+         ahead   =  cos(yaw) * dx + sin(yaw) * dy,
+         offset  = -sin(yaw) * dx + cos(yaw) * dy,
+         distSqr = dx * dx + dy * dy;
+
+  if (distSqr < 1e-9)
+  {
+    lookaheadBearing = 0;
+    return 0;
+  }
+
+  lookaheadBearing = atan2(offset, ahead);
+
+  return 2.0 * offset / distSqr;
+}
+
+/**
+ * @return angle from the robot's heading to the lookahead point as of the last
+ *         call to getCurvature(), between -PI and PI. Positive values are to the left
+ */
+double PurePursuit::getLookaheadBearing() const
+{
+  return lookaheadBearing;
+}
+
+/**
+ * @return true if the lookahead point was behind the robot as of the last call
+ *         to getCurvature(), in which case no forward arc leads to it
+ */
+bool PurePursuit::isLookaheadBehind() const
+{
+  return fabs(lookaheadBearing) > M_PI / 2.0;
+}
+
+/**
+ * Walks along the path from the point closest to the robot. Only looks from
+ * the segment found by the last call to getCurvature().
+ *
+ * @param pos      - position of the robot
+ * @param distance - how far along the path to walk in meters
+ * @return the point that far along the path, or the end of the path if it is closer
+ */
+Vector2 PurePursuit::getPointAhead(Vector2 pos, double distance) const
+{
+  int    i = segment;
+  double t = getSegmentProgress(i, pos);
+
+  for (; i + 1 < (int)path.size(); i++, t = 0)
+  {
+    double remaining = getSegmentLength(i) * (1.0 - t);
+    if (remaining >= distance) return getPointOnSegment(i, t + distance / getSegmentLength(i));
+    distance -= remaining;
+  }
+
+  return path.back();
+}
+
+/** @return the point the robot steered towards on the last call to getCurvature() */
+Vector2 PurePursuit::getLookaheadPoint() const
+{
+  return lookaheadPoint;
+}
+
+/**
+ * @param pos - position of the robot
+ * @return distance left to drive along the path in meters
+ */
+double PurePursuit::getRemainingDistance(Vector2 pos) const
+{
+  double t        = getSegmentProgress(segment, pos);
+  Vector2 closest = getPointOnSegment(segment, t);
+  double distance = hypot(pos.x - closest.x, pos.y - closest.y) +
+                    getSegmentLength(segment) * (1.0 - t);
+
+  for (int i = segment + 1; i + 1 < (int)path.size(); i++) distance += getSegmentLength(i);
+
+  return distance;
+}
@@ -0,0 +1,53 @@
+#ifndef PURE_PURSUIT_H
+#define PURE_PURSUIT_H
+#pragma once
+
+#include <vector>
+#include "Vector2.h"
+
+/**
+ * Pure pursuit path tracker. Each tick the robot picks a point on the path a
+ * lookahead distance ahead of where it is and steers along the arc that passes
+ * through it, so it follows the whole polyline without ever stopping to turn.
+ *
+ * The lookahead grows with speed: short at low speeds so corners are cut
+ * tightly, long at high speeds so the robot does not weave.
+ *
+ * An arc cannot reach a point behind the robot, so when isLookaheadBehind()
+ * the caller should turn in place towards it before driving again.
+ */
+class PurePursuit
+{
+  std::vector<Vector2> path;
+  int    segment;       // the robot is closest to the segment from path[segment] to path[segment + 1]
+  double minLookahead,  // shortest lookahead distance in meters
+         maxLookahead,  // longest lookahead distance in meters
+         lookaheadGain; // seconds of travel to look ahead by
+  Vector2 lookaheadPoint;
+  double  lookaheadBearing; // angle to the lookahead point from the robot's heading in radians
+
+  double getSegmentProgress(int index, Vector2 pos) const;
+  Vector2 getPointOnSegment(int index, double t) const;
+  double getSegmentLength(int index) const;
+  void updateClosestSegment(Vector2 pos);
+
+public:
+  // constructor
+  PurePursuit(const std::vector<Vector2>& path,
+              double minLookahead  = 0.3,
+              double maxLookahead  = 1.5,
+              double lookaheadGain = 1.0);
+
+  // steering
+  double getLookaheadDistance(double speed) const;
+  double getCurvature(Vector2 pos, double yaw, double speed);
+  Vector2 getLookaheadPoint() const;
+  double getLookaheadBearing() const;
+  bool isLookaheadBehind() const;
+
+  // progress along the path
+  Vector2 getPointAhead(Vector2 pos, double distance) const;
+  double getRemainingDistance(Vector2 pos) const;
+};
+
+#endif
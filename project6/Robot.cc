@@ -1,4 +1,10 @@
 #include "Robot.h"
+#include "PurePursuit.h"
+#include "DynamicWindow.h"
+#include "PredictiveController.h"
+#include "MotionProfile.h"
+#include "LatencyHistogram.h"
+#include "RobotTeam.h"
 #include <cstdlib>
 #include <iostream>
 #include <string>
@@ -6,17 +12,45 @@
 #include <stdlib.h> // srand, rand
 #include <time.h>   // time
 #include <cstdio>   // printf
+#include <algorithm> // std::sort, std::min
+#include <chrono>    // std::chrono::steady_clock
 
 // used for comparing doubles to 0
 #define EPSILON std::numeric_limits<double>::epsilon()
 
+// how quickly followPath() slows down for the end of the path, in m/s per meter left
+const double PATH_SLOWDOWN_GAIN = 1.0;
+
+// milliseconds the reader thread waits for data while holding the client. Kept short as
+// commands from the control thread wait on it
+const int READER_PEEK_TIMEOUT = 2;
+
+// localization is only fused in once most of its weight is on the best hypothesis
+const double MIN_HYPOTHESIS_SHARE = 0.5;
+
+// localize() is done once this much of the weight is on the best hypothesis
+const double LOCALIZED_SHARE = 0.95;
+
+// how calibrate() tests the robot's motion
+const double CALIBRATION_VELOCITY         = 0.5; // fastest forward velocity tested in m/s
+const double CALIBRATION_ANGULAR_VELOCITY = 1.0; // fastest angular velocity tested in rad/s
+const int    CALIBRATION_TEST_COUNT       = 3;   // velocities tested, evenly spaced up to the fastest
+const int    CALIBRATION_SETTLE_TICKS     = 5;   // ticks given to reach each velocity before measuring
+
+// how the robot follows motion profiles in followProfile()
+const double PROFILE_TRACKING_GAIN      = 2.0;    // velocity added per unit the robot is behind the profile
+const double PROFILE_SETTLE_TIME        = 1.0;    // seconds allowed after the profile ends to reach the target
+const double PROFILE_DISTANCE_TOLERANCE = 0.01;   // meters the robot may stop short of the target by
+const double PROFILE_ANGLE_TOLERANCE    = 0.0175; // radians the robot may stop short of the target by
+
 /**
  * Set up proxy. Proxies are the datastructures that Player uses to
  * talk to the simulator and the real robot.
  *
  * @param isUsingLaser  - if true, sets up the LaserProxy to be used by the robot
- * @param movementScale - scales the overall velocity of the robot
- * @param rotationScale - scales the overall angular velocity of the robot
+ * @param movementScale - forward command per m/s wanted, until the robot is calibrated.
+ *                        Moves stop on the odometer, so this does not change how far they go
+ * @param rotationScale - angular command per rad/s wanted, until the robot is calibrated
  * @param tickInterval  - the interval that of which the robot ticks at
  * @param hostname      - address to connect to
  */
@@ -26,30 +60,114 @@ Robot::Robot(bool isUsingLaser,
              PositionMethod::Enum posMethod,
              double tickInterval,
              std::string hostname) :
-  MOVEMENT_SCALE(movementScale),
-  ROTATION_SCALE(rotationScale),
+  ownClient(new PlayerCc::PlayerClient(hostname)),
+  robot(*ownClient),
+  team(NULL),
+  state(&ownState),
+  calibration(movementScale, rotationScale),
   TICK_INTERVAL(tickInterval),
   posMethod(posMethod),
   isHandlingBump(false),
   targetWaypoint(NULL),
-  robot(hostname),
+  loop(tickInterval),
+  captureCount(0),
+  lastHypothesisMean(),
+  lastBumperSides(BumperSide::None),
+  bumperEventCount(0),
+  isDispatching(false),
+  isReaderRunning(false),
+  isCancelRequested(false),
+  snapshotLatency(0),
+  snapshotLatencySum(0),
+  maxSnapshotLatency(0),
+  snapshotCount(0),
+  maxAcceleration(1.0),
+  maxAngularAcceleration(2.0),
+  maxJerk(4.0),
+  maxAngularJerk(8.0),
   pp(&robot, 0),
   bp(&robot, 0),
-  lp(&robot, 0)
+  lp(&robot, 0),
+  sp(isUsingLaser ? new PlayerCc::LaserProxy(&robot, 0) : NULL)
 {
+  // only fetch data when asked for it, and only the newest, so reads follow our own tick rate
+  robot.SetDataMode(PLAYER_DATAMODE_PULL);
+  robot.SetReplaceRule(true);
+
+  // print how long each stage of the control loop took once the program ends
+  installStageLatencyDump();
+
+  // a calibration measured earlier beats the scales given here
+  loadCalibration(0);
+
   // initial read to prevent segmentation defaults with proxies
-  robot.Read();
+  read();
 
   // turn on the motor
   setMotorEnable(true);
+}
 
-  // laser setup
-  sp = isUsingLaser ? new PlayerCc::LaserProxy(&robot, 0) : NULL;
+/**
+ * Set up the proxies of one robot in a team. The robot talks through the
+ * team's client and the team reads for every robot at once, so the first
+ * read is left to the team once every robot has been created.
+ *
+ * @param team          - the team the robot belongs to
+ * @param index         - index of the robot's devices on the server, e.g. 1 for position2d:1
+ * @param isUsingLaser  - if true, sets up the LaserProxy to be used by the robot
+ * @param movementScale - forward command per m/s wanted, until the robot is calibrated.
+ *                        Moves stop on the odometer, so this does not change how far they go
+ * @param rotationScale - angular command per rad/s wanted, until the robot is calibrated
+ * @param posMethod     - the default way for the robot to determine its location
+ */
+Robot::Robot(RobotTeam& team,
+             int    index,
+             bool   isUsingLaser,
+             double movementScale,
+             double rotationScale,
+             PositionMethod::Enum posMethod) :
+  robot(team.client),
+  team(&team),
+  state(&team.states[index]),
+  calibration(movementScale, rotationScale),
+  TICK_INTERVAL(team.loop.getPeriod()),
+  posMethod(posMethod),
+  isHandlingBump(false),
+  targetWaypoint(NULL),
+  loop(team.loop.getPeriod()),
+  captureCount(0),
+  lastHypothesisMean(),
+  lastBumperSides(BumperSide::None),
+  bumperEventCount(0),
+  isDispatching(false),
+  isReaderRunning(false),
+  isCancelRequested(false),
+  snapshotLatency(0),
+  snapshotLatencySum(0),
+  maxSnapshotLatency(0),
+  snapshotCount(0),
+  maxAcceleration(1.0),
+  maxAngularAcceleration(2.0),
+  maxJerk(4.0),
+  maxAngularJerk(8.0),
+  pp(&robot, index),
+  bp(&robot, index),
+  lp(&robot, index),
+  sp(isUsingLaser ? new PlayerCc::LaserProxy(&robot, index) : NULL)
+{
+  // a calibration measured earlier beats the scales given here
+  loadCalibration(index);
+
+  // turn on the motor
+  setMotorEnable(true);
 }
 
 /** Destructor used to release memory */
 Robot::~Robot()
 {
+  // the reader thread uses the proxies so it must stop before anything else
+  stopReaderThread();
+
   // turn off the motor
   setMotorEnable(false);
 
@@ -61,135 +179,535 @@ Robot::~Robot()
   std::cout << "\nPowering off. Goodbye! o7\n";
 }
 
-/** Read from the environment */
-void Robot::read()
+/** @return time on the monotonic clock in seconds */
+static double getMonotonicTime()
 {
-  robot.Read();
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
 }
 
 /**
- * Clamps the given yaw between -PI to PI
- * @return the clamped yaw
- */ 
-double Robot::clampYawToPi(double yaw)
+ * Orders hypotheses so that the one with the most weight comes first
+ *
+ * @param a - first hypothesis to compare
+ * @param b - second hypothesis to compare
+ * @return true if a has more weight than b
+ */
+static bool isMoreLikely(const player_localize_hypoth_t& a, const player_localize_hypoth_t& b)
 {
-  yaw = fmod(yaw + M_PI, 2.0 * M_PI);
-  return yaw + (yaw < 0 ? M_PI : -M_PI);
+  return a.alpha > b.alpha;
 }
 
+/** Creates an empty snapshot for before the first read */
+RobotState::RobotState() :
+  generation(0),
+  timestamp(0),
+  dt(0),
+  captureTime(0),
+  readLatency(0),
+  odometerYaw(0),
+  isLeftPressed(false),
+  isRightPressed(false),
+  isAnyPressed(false),
+  hypothesisWeight(0),
+  fusedYaw(0),
+  fusedCovariance(),
+  laserMaxRange(0),
+  laserMinLeft(0),
+  laserMinRight(0) {}
+
 /**
- * Move and rotate the robot over the given number of ticks
- *
- * @param forwardVelocity - forward velocity to move in meters per second
- * @param angularVelocity - angular velocity to rotate in radians per second
- * @param ticks           - number of ticks to apply the forward/angular velocities to the robot for
- * @return true if the robot completed the entirety of its movement
+ * Read from the environment. This is the start of every tick: it waits for the
+ * control loop's next deadline, fetches the newest data from the server, then
+ * takes a snapshot of every proxy so the rest of the tick never has to wait
+ * on the server again. A robot in a team has the team read instead, which
+ * also updates every other robot in the team.
  */
-bool Robot::moveAndRotateOverTicks(double forwardVelocity, double angularVelocity, int ticks)
+void Robot::read()
 {
-  // invalid ticks. return true for the robot technically completed the entirety of its movement
-  if (ticks < 1) return true;
-
-  double velocityScale, // scale velocity for proportional control
-         movementDiff;  // difference between movement last tick and velocity
+  // a team reads for all of its robots at once
+  if (team)
+  {
+    team->read();
+    if (readListener) readListener(*state);
+    return;
+  }
 
-  Vector2 lastPos, // robot's position before moving this tick
-          curPos;  // robot's position after moving
+  double dt = loop.waitForNextTick();
 
-  // double ticks to account for proportional control
-  ticks *= 2;
+  // only time the reading itself, not the wait for the deadline
+  TIME_STAGE(ProfileStage::Read);
 
-  // obtain robot's initial position
-  robot.Read();
-  curPos = getLocalizedPos();
+  if (isReaderRunning)
+  {
+    // take whatever the reader thread published last. If nothing new came in the old snapshot stays
+    if (snapshots.update())
+    {
+      *state = snapshots.getFront();
 
-  // Enter movement control loop
-  int curTick;
-  for (curTick = 0; curTick < ticks; ++curTick)
+      snapshotLatency     = getMonotonicTime() - state->captureTime;
+      snapshotLatencySum += snapshotLatency;
+      snapshotCount++;
+      if (snapshotLatency > maxSnapshotLatency) maxSnapshotLatency = snapshotLatency;
+    }
+  }
+  else
   {
-    // read from proxies
+    // the server took the data somewhere during the read, most likely halfway through
+    double start = getMonotonicTime();
     robot.Read();
+    captureState(*state, (getMonotonicTime() - start) / 2.0);
+  }
 
-    // scale velocity based on current and max ticks
-    velocityScale = (1.0 - ((double)curTick) / ((double)ticks));
+  state->dt = dt;
 
-    // set the last position to be our current one
-    lastPos = curPos;
+  dispatchBumperEvents();
 
-    // move the robot
-    pp.SetSpeed(forwardVelocity * velocityScale, angularVelocity * velocityScale);
+  if (readListener) readListener(*state);
+}
 
-    // obtain the new current position
-    curPos = getPos();
+/**
+ * Starts the control loop over at the start of a motion, so the time the robot
+ * sat idle since the last motion is not measured as one long tick. A team's
+ * loop is left alone as the team keeps reading for its other robots.
+ */
+void Robot::restartLoop()
+{
+  if (!team) loop.reset();
+}
 
-    // find the difference between how far the robot moved compared to what was expected
-    movementDiff = Vector2::getMagnitude(curPos - lastPos) - fabs(forwardVelocity * TICK_INTERVAL * velocityScale);
+/**
+ * Looks for bumpers that were pressed or released since the last read and
+ * hands the edges to every handler straight away, so the robot reacts within
+ * the tick the bump was seen in. Edges seen while a handler is running are
+ * queued and handed over once it returns, so handlers never run inside each
+ * other but no edge is lost. The edge still counts towards
+ * getBumperEventCount() right away, which stops whatever motion the handler
+ * is in the middle of.
+ */
+void Robot::dispatchBumperEvents()
+{
+  int sides = (state->isLeftPressed  ? BumperSide::Left  : BumperSide::None) |
+              (state->isRightPressed ? BumperSide::Right : BumperSide::None);
 
-    // break if difference is too large (sign that the robot has been kidnapped)
-    if (movementDiff > 0.2) break;
+  int pressed  = sides & ~lastBumperSides,
+      released = lastBumperSides & ~sides;
+  lastBumperSides = sides;
 
-    // break if we have reached the waypoint we are heading towards
-    if (targetWaypoint && forwardVelocity && hasReachedWaypoint(*targetWaypoint)) break;
+  if (pressed | released)
+  {
+    BumperEvent event;
+    event.pressed  = pressed;
+    event.released = released;
+    event.state    = *state;
+    pendingBumperEvents.push_back(event);
+    bumperEventCount++;
+  }
 
-    // break if a bumper has been pressed and we're not currently handling a bumper event
-    if (!isHandlingBump && isAnyPressed()) break;
+  if (isDispatching || pendingBumperEvents.empty()) return;
+
+  isDispatching = true;
+  for (int e = 0; e < pendingBumperEvents.size(); e++)
+  {
+    // copy the event as handlers may queue more, and the handlers so they can register or remove handlers themselves
+    BumperEvent                    event    = pendingBumperEvents[e];
+    std::vector<BumperEventState*> handlers = bumperHandlers;
+
+    for (int i = 0; i < handlers.size(); i++) handlers[i]->onBumperEvent(this, event);
   }
+  pendingBumperEvents.clear();
+  isDispatching = false;
+}
 
-  // stop moving
-  pp.SetSpeed(0, 0);
+/**
+ * Has the handler told about every bumper edge from now on
+ * @param handler - the handler to add. Must stay alive until it is removed
+ */
+void Robot::addBumperHandler(BumperEventState *handler)
+{
+  if (std::find(bumperHandlers.begin(), bumperHandlers.end(), handler) == bumperHandlers.end())
+  {
+    bumperHandlers.push_back(handler);
+  }
+}
 
-  // return true if we finished the entirety of the robot's movement
-  return curTick == ticks;
+/**
+ * Stops telling the handler about bumper edges
+ * @param handler - the handler to remove
+ */
+void Robot::removeBumperHandler(BumperEventState *handler)
+{
+  bumperHandlers.erase(std::remove(bumperHandlers.begin(), bumperHandlers.end(), handler),
+                       bumperHandlers.end());
 }
 
 /**
- * Calculates what the velocity and ticks should be to cover the given distance. The given velocity
- * and ticks are mutated to match this calculation.
+ * Gets the number of bumper edges dispatched to handlers. Motions compare
+ * this before and after a read to find out whether a handler took over.
  *
- * The velocity variable will remain the same unless a negative distance is given. Be that the
- * case, velocity will be negated. Its absolute value will never change though.
+ * @return number of bumper edges dispatched so far
+ */
+unsigned long Robot::getBumperEventCount() const
+{
+  return bumperEventCount;
+}
+
+/**
+ * Has the motion running on another thread stop as soon as it next checks,
+ * which is at least once a tick. Every motion stops early once this is called
+ * until clearCancel() is called.
+ */
+void Robot::cancelMotion()
+{
+  isCancelRequested = true;
+}
+
+/** Lets motions run again after cancelMotion() */
+void Robot::clearCancel()
+{
+  isCancelRequested = false;
+}
+
+/** @return true if motions have been cancelled and are stopping early */
+bool Robot::isMotionCancelled() const
+{
+  return isCancelRequested;
+}
+
+/**
+ * Has the listener called with every snapshot as soon as it is read, on
+ * whichever thread did the reading
  *
- * The ticks variable will be approximated to match the number of ticks needed to cover the given
- * distance with our current velocity.
+ * @param listener - function to call, or an empty function to stop calling one
+ */
+void Robot::setReadListener(std::function<void(const RobotState&)> listener)
+{
+  readListener = listener;
+}
+
+/**
+ * Hands reading over to a background thread so work done between reads never
+ * leaves the robot acting on stale data. The thread reads whenever the server
+ * publishes and read() just takes the newest snapshot without waiting.
+ */
+void Robot::startReaderThread()
+{
+  // the team's client is shared, so only the team may read from it
+  if (isReaderRunning || team) return;
+
+  // the thread waits on the server itself, so have the server send data as soon as it has it
+  robot.SetDataMode(PLAYER_DATAMODE_PUSH);
+
+  isReaderRunning = true;
+  readerThread    = std::thread(&Robot::runReader, this);
+}
+
+/** Stops the background thread and goes back to reading on the calling thread */
+void Robot::stopReaderThread()
+{
+  if (!isReaderRunning) return;
+
+  isReaderRunning = false;
+  readerThread.join();
+
+  robot.SetDataMode(PLAYER_DATAMODE_PULL);
+}
+
+/**
+ * Body of the background thread. The client is not thread-safe, so it is
+ * locked while waiting for data as well as while reading it. The wait is kept
+ * short and the lock let go in between, so commands sent from the control
+ * thread are held up by at most READER_PEEK_TIMEOUT.
+ */
+void Robot::runReader()
+{
+  while (isReaderRunning)
+  {
+    {
+      std::lock_guard<std::mutex> lock(clientMutex);
+      if (robot.Peek(READER_PEEK_TIMEOUT))
+      {
+        double start = getMonotonicTime();
+        robot.ReadIfWaiting();
+        captureState(snapshots.getBack(), (getMonotonicTime() - start) / 2.0);
+        snapshots.publish();
+        continue;
+      }
+    }
+
+    // give the control thread a chance at the client before waiting again
+    std::this_thread::yield();
+  }
+}
+
+/**
+ * Sends a velocity command to the robot. The client is locked so this is
+ * safe while the reader thread is running.
  *
- * For example, to cover 1 meter while traveling at 0.1 m/s, we divide
- * 1m by 0.1m/s to get 10s. We then divide that result by the number of ticks
- * that occur in a second (default is 10 as per TICK_INTERVAL). So 10s divided
- * by 0.1s is 100. So, for the robot to travel 1 meter while going at 0.1 m/s,
- * it will take a total of 100 ticks.
+ * @param forwardVelocity - forward velocity in m/s
+ * @param angularVelocity - angular velocity in rad/s
+ */
+void Robot::sendSpeed(double forwardVelocity, double angularVelocity)
+{
+  TIME_STAGE(ProfileStage::Command);
+
+  // remember how the robot should really move from now on, for getPredictedPose()
+  predictor.addCommand(getMonotonicTime(),
+                       calibration.getVelocity(forwardVelocity, false),
+                       calibration.getVelocity(angularVelocity, true));
+
+  std::lock_guard<std::mutex> lock(clientMutex);
+  pp.SetSpeed(forwardVelocity, angularVelocity);
+}
+
+/**
+ * Gets the time between the reader thread taking the last snapshot and read() handing it over
+ * @return latency in seconds, or 0 if the reader thread has not been used
+ */
+double Robot::getSnapshotLatency() const
+{
+  return snapshotLatency;
+}
+
+/** @return average latency of every snapshot handed over by the reader thread in seconds */
+double Robot::getMeanSnapshotLatency() const
+{
+  return snapshotCount ? snapshotLatencySum / snapshotCount : 0;
+}
+
+/** @return largest latency of any snapshot handed over by the reader thread in seconds */
+double Robot::getMaxSnapshotLatency() const
+{
+  return maxSnapshotLatency;
+}
+
+/**
+ * Gets the snapshot taken by the last read
+ * @return the robot's state as of the last read
+ */
+const RobotState& Robot::getState() const
+{
+  return *state;
+}
+
+/**
+ * Gets the loop pacing reads, for checking how well it keeps to the tick interval
+ * @return the robot's control loop
+ */
+const ControlLoop& Robot::getControlLoop() const
+{
+  return loop;
+}
+
+/**
+ * Copies everything the robot needs from the proxies into a snapshot
  *
- * @param  distance - total distance to travel
- * @param  velocity - rate that of which we are traveling. Original variable will be negated
- *                    if traveling a negative distance
- * @param ticks     - mutates the original variable with the number of ticks needed to cover
- *                    the given distance at the given velocity
+ * @param snapshot    - the snapshot to fill in
+ * @param readLatency - estimated time between the server taking the data and now in seconds
+ */
+void Robot::captureState(RobotState& snapshot, double readLatency)
+{
+  snapshot.generation  = ++captureCount;
+  snapshot.captureTime = getMonotonicTime();
+  snapshot.readLatency = readLatency;
+  snapshot.timestamp = pp.GetDataTime();
+
+  // odometry
+  snapshot.odometerPos = Vector2(pp.GetXPos(), pp.GetYPos());
+  snapshot.odometerYaw = pp.GetYaw();
+
+  // bumpers
+  snapshot.isLeftPressed  = bp[0];
+  snapshot.isRightPressed = bp[1];
+  snapshot.isAnyPressed   = bp.IsAnyBumped();
+
+  // localization. Sorting here means pose lookups during the tick never rescan AMCL's output
+  snapshot.hypotheses.resize(lp.GetHypothCount());
+  snapshot.hypothesisWeight = 0;
+  for (int i = 0; i < snapshot.hypotheses.size(); i++)
+  {
+    snapshot.hypotheses[i]     = lp.GetHypoth(i);
+    snapshot.hypothesisWeight += snapshot.hypotheses[i].alpha;
+  }
+  std::sort(snapshot.hypotheses.begin(), snapshot.hypotheses.end(), isMoreLikely);
+
+  // fuse the odometer with localization's estimate, skipping it while localization is still unsure
+  predictor.addOdometry(snapshot.captureTime - readLatency, snapshot.odometerPos, snapshot.odometerYaw);
+  poseFilter.predict(snapshot.odometerPos, snapshot.odometerYaw);
+
+  const player_localize_hypoth_t *best = snapshot.hypotheses.empty() ? NULL : &snapshot.hypotheses[0];
+  bool isNewEstimate = best && (best->mean.px != lastHypothesisMean.px ||
+                                best->mean.py != lastHypothesisMean.py ||
+                                best->mean.pa != lastHypothesisMean.pa);
+
+  if (isNewEstimate && best->alpha >= MIN_HYPOTHESIS_SHARE * snapshot.hypothesisWeight)
+  {
+    // the estimate is for where the robot was when localization got its data, so move it along
+    // by however far the odometer has gone since
+    predictor.addLocalizationLatency(pp.GetDataTime() - lp.GetDataTime());
+
+    Vector2 pos(best->mean.px, best->mean.py);
+    double  yaw  = best->mean.pa,
+            time = snapshot.captureTime - readLatency;
+    predictor.compensate(time - predictor.getLocalizationLatency(), time, pos, yaw);
+
+    poseFilter.correct(pos, yaw, best->cov);
+  }
+  if (best) lastHypothesisMean = best->mean;
+  snapshot.fusedPos = poseFilter.getPos();
+  snapshot.fusedYaw = poseFilter.getYaw();
+  poseFilter.getCovariance(snapshot.fusedCovariance);
+
+  // laser
+  if (!sp) return;
+
+  snapshot.laserRanges.resize(sp->GetCount());
+  snapshot.laserBearings.resize(sp->GetCount());
+  for (int i = 0; i < snapshot.laserRanges.size(); i++)
+  {
+    snapshot.laserRanges[i]   = sp->GetRange(i);
+    snapshot.laserBearings[i] = sp->GetBearing(i);
+  }
+
+  snapshot.laserMaxRange = sp->GetMaxRange();
+  snapshot.laserMinLeft  = sp->MinLeft();
+  snapshot.laserMinRight = sp->MinRight();
+}
+
+/**
+ * Clamps the given yaw between -PI to PI
+ * @return the clamped yaw
  */ 
-void Robot::getFinalTicksAndVelocity(double distance, double& velocity, int& ticks)
+double Robot::clampYawToPi(double yaw)
 {
-  // if distance or velocity is 0, return for there is nothing to be done
-  if (fabs(distance) < EPSILON || fabs(velocity) < EPSILON)
+  yaw = fmod(yaw + M_PI, 2.0 * M_PI);
+  return yaw + (yaw < 0 ? M_PI : -M_PI);
+}
+
+/**
+ * Moves or rotates the robot along a motion profile so it covers the whole
+ * distance in a single pass. The profile's velocity is sent every tick along
+ * with a correction for how far the odometer says the robot is behind or ahead
+ * of where the profile expects it to be.
+ *
+ * @param distance   - distance to move in meters, or angle to rotate in radians.
+ *                     Negative values move backwards or rotate clockwise
+ * @param velocity   - top velocity in m/s or rad/s
+ * @param isRotation - true to rotate in place, false to move forward
+ * @return true if the robot ended up within tolerance of the target
+ */
+bool Robot::followProfile(double distance, double velocity, bool isRotation)
+{
+  TIME_STAGE(ProfileStage::FollowProfile);
+
+  MotionProfile profile(distance,
+                        velocity,
+                        isRotation ? maxAngularAcceleration : maxAcceleration,
+                        isRotation ? maxAngularJerk         : maxJerk);
+
+  double tolerance = isRotation ? PROFILE_ANGLE_TOLERANCE : PROFILE_DISTANCE_TOLERANCE,
+         progress  = 0, // distance covered so far according to the odometer
+         command,       // velocity sent to the robot this tick
+         elapsed   = 0; // measured time since the start of the profile
+
+  // obtain robot's initial position
+  restartLoop();
+  read();
+
+  Vector2 startPos = getOdometerPos();
+  double  startYaw = getOdometerYaw(),
+          lastYaw  = startYaw;
+
+  motionMonitor.reset(startPos, startYaw, getLocalizedPos(), getLocalizedYaw());
+
+  unsigned long startBumperEvents = bumperEventCount;
+
+  // Enter movement control loop
+  bool isComplete = false;
+  while (1)
   {
-    ticks = 0;
-    return;
+    // done once the profile has run out and the robot has settled on the target. If it
+    // still has not reached the target after settling, it stalled and the move failed
+    if (elapsed >= profile.getDuration())
+    {
+      isComplete = fabs(distance - progress) < tolerance;
+      if (isComplete || elapsed >= profile.getDuration() + PROFILE_SETTLE_TIME) break;
+    }
+
+    // feed forward the profile's velocity and correct for any error in tracking it
+    {
+      TIME_STAGE(ProfileStage::Decide);
+      command = calibration.getCommand(profile.getVelocity(elapsed), isRotation) +
+                PROFILE_TRACKING_GAIN * (profile.getPosition(elapsed) - progress);
+    }
+
+    if (isRotation) sendSpeed(0, command);
+    else            sendSpeed(command, 0);
+
+    // read from proxies. Going by the measured tick length keeps the robot on the profile
+    // even when the server is slow to respond
+    read();
+    elapsed += state->dt;
+
+    // measure progress along the profile with the odometer
+    {
+      TIME_STAGE(ProfileStage::Localize);
+      if (isRotation)
+      {
+        progress += clampYawToPi(getOdometerYaw() - lastYaw);
+        lastYaw   = getOdometerYaw();
+      }
+      else
+      {
+        Vector2 moved = getOdometerPos() - startPos;
+        progress = moved.x * cos(startYaw) + moved.y * sin(startYaw);
+      }
+
+      motionMonitor.update(getOdometerPos(), getOdometerYaw(), getLocalizedPos(), getLocalizedYaw());
+    }
+
+    // break if the odometer and localization disagree by more than noise, as the odometer can no
+    // longer be trusted to say when the move is done. Localization jumps that snap back are ignored
+    if (motionMonitor.getFault() != MotionFault::None)
+    {
+      std::cout << "\nStopping early: " <<
+                   (motionMonitor.getFault() == MotionFault::Slip ? "wheels slipping" : "localization jumped") <<
+                   " (" << motionMonitor.getGlitchCount() << " localization glitches ignored so far)\n";
+      break;
+    }
+
+    // break if we have reached the waypoint we are heading towards
+    if (targetWaypoint && !isRotation && hasReachedWaypoint(*targetWaypoint)) break;
+
+    // break if a bumper has been pressed and we're not currently handling a bumper event
+    if (!isHandlingBump && isAnyPressed()) break;
+
+    // break on a new bumper edge, which a handler has either dealt with already or will once
+    // the handler that is running now returns. Backing off an obstacle ignores them like any press
+    if (!isHandlingBump && bumperEventCount != startBumperEvents) break;
+
+    // break if the motion was cancelled from another thread
+    if (isCancelRequested) break;
   }
 
-  // if negative distance, negate the velocity
-  if (distance < 0) velocity *= -1;
+  // stop moving
+  sendSpeed(0, 0);
 
-  ticks = abs((int)(distance / velocity / TICK_INTERVAL)); 
+  // return true if the robot reached the target
+  return isComplete;
 }
 
 /**
- * Generates the shortest angle the robot needs to face a given waypoint.
+ * Generates the shortest angle the robot needs to face a given waypoint
+ * as of the last read.
  *
  * @param wp       - the waypoint we want to move to as a Vector2
  * @return angle to face waypoint in radians
  */ 
 double Robot::getAngleToWaypoint(Vector2& wp)
 {
-  robot.Read();
-  Vector2 pos = getPos();
-  double  yaw = getYaw();
+  Vector2 pos;
+  double  yaw;
+  getPredictedPose(pos, yaw);
 
   // center the waypoint with the robot's position as the origin
   Vector2 centered = wp - pos;
@@ -200,14 +718,14 @@ double Robot::getAngleToWaypoint(Vector2& wp)
 
 /**
  * Obtains the distance between the given robot's position and the waypoint
+ * as of the last read.
  *
  * @param wp       - the waypoint we want to move to
  * @return distance between the two points in meters
  */ 
 double Robot::getDistanceToWaypoint(Vector2& wp)
 {
-  robot.Read();
-  Vector2 pos = getPos();
+  Vector2 pos = getPredictedPos();
 
   // calculate the distance between the robot and the given waypoint
   return Vector2::getMagnitude(pos - wp); 
@@ -219,7 +737,7 @@ double Robot::getDistanceToWaypoint(Vector2& wp)
  */ 
 Vector2 Robot::getOdometerPos()
 {
-  return Vector2(pp.GetXPos(), pp.GetYPos());
+  return state->odometerPos;
 }
 
 /**
@@ -228,27 +746,103 @@ Vector2 Robot::getOdometerPos()
  */
 double Robot::getOdometerYaw()
 {
-  return pp.GetYaw();
+  return state->odometerYaw;
 }
 
 /**
  * Gets the current position of the robot based off of localization
- * @return Vector2 of the robot's current localized position
+ * @return Vector2 of the robot's current localized position, or the
+ *         odometer's position if localization has no hypotheses yet
  */ 
 Vector2 Robot::getLocalizedPos()
 {
-  player_pose2d_t pose = getPoseFromLocalizeProxy();
+  player_pose2d_t pose;
+  if (!getPoseFromLocalizeProxy(pose)) return getOdometerPos();
 
   return Vector2(pose.px, pose.py);
 }
 
 /**
  * Gets Robot Yaw rotation based on localization
- * @return Robot's localized Yaw rotation as double
+ * @return Robot's localized Yaw rotation as double, or the odometer's yaw
+ *         if localization has no hypotheses yet
  */ 
 double Robot::getLocalizedYaw()
 {
-  return getPoseFromLocalizeProxy().pa;
+  player_pose2d_t pose;
+  if (!getPoseFromLocalizeProxy(pose)) return getOdometerYaw();
+
+  return pose.pa;
+}
+
+/**
+ * Gets the position of the robot with odometry and localization fused together
+ * @return Vector2 of the robot's fused position as of the last read
+ */
+Vector2 Robot::getFusedPos()
+{
+  return state->fusedPos;
+}
+
+/**
+ * Gets Robot Yaw rotation with odometry and localization fused together
+ * @return Robot's fused Yaw rotation as double
+ */
+double Robot::getFusedYaw()
+{
+  return state->fusedYaw;
+}
+
+/**
+ * Gets how sure the fused pose is as of the last read
+ * @param covariance - set to the covariance of x, y and yaw
+ */
+void Robot::getPoseCovariance(double covariance[3][3]) const
+{
+  for (int i = 0; i < 3; i++)
+  {
+    for (int j = 0; j < 3; j++) covariance[i][j] = state->fusedCovariance[i][j];
+  }
+}
+
+/**
+ * Gets the robot's pose brought forward from the last read to right now, by
+ * the commands the robot has been following since the server took the data.
+ * The snapshot is already stale by the time the robot acts on it, which at
+ * speed is enough to miss or overshoot a waypoint.
+ *
+ * @param pos - set to the position based on the PositionMethod, as of right now
+ * @param yaw - set to the yaw based on the PositionMethod, as of right now
+ */
+void Robot::getPredictedPose(Vector2& pos, double& yaw)
+{
+  pos = getPos();
+  yaw = getYaw();
+  predictor.predict(state->captureTime - state->readLatency, getMonotonicTime(), pos, yaw);
+}
+
+/**
+ * Gets the position of the robot as of right now
+ * @return Vector2 of the robot's predicted position
+ */
+Vector2 Robot::getPredictedPos()
+{
+  Vector2 pos;
+  double  yaw;
+  getPredictedPose(pos, yaw);
+  return pos;
+}
+
+/**
+ * Gets Robot Yaw rotation as of right now
+ * @return Robot's predicted Yaw rotation as double
+ */
+double Robot::getPredictedYaw()
+{
+  Vector2 pos;
+  double  yaw;
+  getPredictedPose(pos, yaw);
+  return yaw;
 }
 
 /**
@@ -258,6 +852,7 @@ double Robot::getLocalizedYaw()
 Vector2 Robot::getPos()
 {
   if (posMethod == PositionMethod::Localization) return getLocalizedPos();
+  if (posMethod == PositionMethod::Fused)        return getFusedPos();
 
   return getOdometerPos();
 }
@@ -269,6 +864,7 @@ Vector2 Robot::getPos()
 double Robot::getYaw()
 {
   if (posMethod == PositionMethod::Localization) return getLocalizedYaw();
+  if (posMethod == PositionMethod::Fused)        return getFusedYaw();
 
   return getOdometerYaw();
 }
@@ -279,7 +875,7 @@ double Robot::getYaw()
  */
 bool Robot::isLeftPressed()
 {
-  return bp[0];
+  return state->isLeftPressed;
 }
 
 /**
@@ -288,7 +884,7 @@ bool Robot::isLeftPressed()
  */
 bool Robot::isRightPressed()
 {
-  return bp[1];
+  return state->isRightPressed;
 }
 
 /**
@@ -297,7 +893,7 @@ bool Robot::isRightPressed()
  */ 
 bool Robot::isBothPressed()
 {
-  return bp[0] && bp[1];
+  return state->isLeftPressed && state->isRightPressed;
 }
 
 /**
@@ -306,7 +902,31 @@ bool Robot::isBothPressed()
  */
 bool Robot::isAnyPressed()
 {
-  return bp.IsAnyBumped();
+  return state->isAnyPressed;
+}
+
+/**
+ * Copies the latest scan from the laser
+ *
+ * @param ranges   - filled in with the distance measured by each beam in meters
+ * @param bearings - filled in with the angle of each beam relative to the robot in radians
+ * @return true if the robot has a laser. False otherwise
+ */
+bool Robot::getLaserScan(std::vector<double>& ranges, std::vector<double>& bearings)
+{
+  ranges   = state->laserRanges;
+  bearings = state->laserBearings;
+
+  return sp != NULL;
+}
+
+/**
+ * Gets the furthest distance the laser can measure
+ * @return max range of the laser in meters or 0 if the robot has no laser
+ */
+double Robot::getMaxLaserRange()
+{
+  return state->laserMaxRange;
 }
 
 /** Prints the X, Y, and Yaw odometry positions of the Robot */
@@ -323,7 +943,13 @@ void Robot::printOdometerPosition()
 /** Prints the X, Y, and Yaw positions of the robot based on localization */
 void Robot::printLocalizedPosition()
 {
-  player_pose2d_t pose = getPoseFromLocalizeProxy();
+  player_pose2d_t pose;
+  if (!getPoseFromLocalizeProxy(pose))
+  {
+    std::cout << "Robot Localized Position: no hypotheses yet\n";
+    return;
+  }
+
   std::cout << "Robot Localized Position"  << "\n" <<
                "------------------------"  << "\n" <<
                "X:   " << pose.px          << "\n" <<
@@ -334,18 +960,17 @@ void Robot::printLocalizedPosition()
 /** Prints all hypotheses */
 void Robot::printAllHypotheses()
 {
-  player_localize_hypoth_t hypothesis;
-  player_pose2d_t          pose;
-  double                   weight;
-  uint32_t                 hCount = lp.GetHypothCount();
+  player_pose2d_t pose;
+  double          weight;
+  uint32_t        hCount = state->hypotheses.size();
 
   if (hCount < 1) return;
 
-  std::cout << "AMCL gives us " << hCount + 1 << " possible locations:" << "\n";
+  std::cout << "AMCL gives us " << hCount << " possible locations:" << "\n";
 
-  for (int i = 0; i <= hCount; i++)
+  for (int i = 0; i < hCount; i++)
   {
-    hypothesis = lp.GetHypoth(i);
+    const player_localize_hypoth_t& hypothesis = state->hypotheses[i];
     pose       = hypothesis.mean;
     weight     = hypothesis.alpha;
     printf("X:%10f Y:%10f A:%10f W:%10f\n", pose.px, pose.py, pose.pa, weight);
@@ -365,42 +990,55 @@ void Robot::printBumper()
 /** Prints data from the laser */
 void Robot::printLaserData()
 {
-  if (!sp) return;
-
-  std::cout << "Max laser distance:        " << sp->GetMaxRange() << "\n" <<
-               "Number of readings:        " << sp->GetCount()    << "\n" <<
-               "Closest thing on left:     " << sp->MinLeft()     << "\n" <<
-               "Closest thing on right:    " << sp->MinRight()    << "\n" <<
-               "Range of a single point:   " << sp->GetRange(5)   << "\n" <<
-               "Bearing of a single point: " << sp->GetBearing(5) << "\n";
+  if (!sp || state->laserRanges.size() <= 5) return;
+
+  std::cout << "Max laser distance:        " << state->laserMaxRange      << "\n" <<
+               "Number of readings:        " << state->laserRanges.size() << "\n" <<
+               "Closest thing on left:     " << state->laserMinLeft       << "\n" <<
+               "Closest thing on right:    " << state->laserMinRight      << "\n" <<
+               "Range of a single point:   " << state->laserRanges[5]     << "\n" <<
+               "Bearing of a single point: " << state->laserBearings[5]   << "\n";
 }
 
 /**
- * Finds the hypothesis with the greatest weight
+ * Finds the hypothesis with the greatest weight. The hypotheses are sorted
+ * once per read, so this is just the first one.
  *
- * @return hypothesis with greatest weight
+ * @param hypothesis - set to the hypothesis with the greatest weight
+ * @return false if AMCL has not given us any hypotheses yet, leaving hypothesis unchanged
  */ 
-player_localize_hypoth_t Robot::getBestLocalizeHypothesis()
+bool Robot::getBestLocalizeHypothesis(player_localize_hypoth_t& hypothesis) const
 {
-  player_localize_hypoth_t hypothesis;
-  int                      maxIndex;
-  double                   weight, maxWeight = 0;
+  if (state->hypotheses.empty()) return false;
 
-  // Find pose with the most weight
-  for (int i = 0; i <= lp.GetHypothCount(); i++)
-  {
-    hypothesis = lp.GetHypoth(i);
-    weight     = hypothesis.alpha;
+  hypothesis = state->hypotheses[0];
+  return true;
+}
 
-    if (weight > maxWeight)
-    {
-      maxWeight = weight;
-      maxIndex  = i;
-    }
-  }
+/**
+ * Gets the most likely hypotheses as of the last read
+ *
+ * @param k     - the greatest number of hypotheses wanted
+ * @param count - set to the number of hypotheses returned, which is less
+ *                than k if AMCL gave us fewer
+ * @return hypotheses sorted so the most likely comes first, valid until the next read
+ */
+const player_localize_hypoth_t* Robot::getTopHypotheses(int k, int& count) const
+{
+  count = std::min(k, (int)state->hypotheses.size());
 
-  // Returns hypothesis with the most weight
-  return lp.GetHypoth(maxIndex);
+  return count > 0 ? &state->hypotheses[0] : NULL;
+}
+
+/**
+ * Gets the total weight of every hypothesis as of the last read. Dividing
+ * a hypothesis' weight by this gives how likely it is compared to the rest.
+ *
+ * @return sum of the weights of every hypothesis
+ */
+double Robot::getTotalHypothesisWeight() const
+{
+  return state->hypothesisWeight;
 }
 
 /**
@@ -413,11 +1051,27 @@ player_localize_hypoth_t Robot::getBestLocalizeHypothesis()
  * As the number of hypotheses drops, the robot should be more sure
  * of where it is.
  *
- * @return the pose with the greatest amount of weight
+ * @param pose - set to the pose with the greatest amount of weight
+ * @return false if there are no hypotheses yet, leaving pose unchanged
+ */
+bool Robot::getPoseFromLocalizeProxy(player_pose2d_t& pose) const
+{
+  player_localize_hypoth_t hypothesis;
+  if (!getBestLocalizeHypothesis(hypothesis)) return false;
+
+  pose = hypothesis.mean;
+  return true;
+}
+
+/**
+ * @return true as of the last read if only one hypothesis is left or the best
+ *         one holds almost all of the weight. Every way of localizing stops on this
  */
-player_pose2d_t Robot::getPoseFromLocalizeProxy()
+bool Robot::isLocalized() const
 {
-  return getBestLocalizeHypothesis().mean;
+  return state->hypotheses.size() == 1 ||
+         (!state->hypotheses.empty() &&
+          state->hypotheses[0].alpha >= LOCALIZED_SHARE * state->hypothesisWeight);
 }
 
 /**
@@ -426,21 +1080,172 @@ player_pose2d_t Robot::getPoseFromLocalizeProxy()
  */ 
 void Robot::localize()
 {
+  double start = getMonotonicTime();
+  restartLoop();
+
   // endlessly loop until the robot is certain of where it is
   while (1)
   {
-    robot.Read();
+    read();
+    if (isCancelRequested) break;
 
     printAllHypotheses();
 
-    // if only one hypothesis remains, return
-    if (lp.GetHypothCount() == 1) return;
+    // if the robot is certain of where it is, return
+    if (isLocalized())
+    {
+      printf("Localized in %.1fs\n", getMonotonicTime() - start);
+      return;
+    }
 
     // travel backwards in a circle shape
     setSpeed(-0.75, 1.0);
   }
 }
 
+/**
+ * Sets the limits used to build motion profiles for moveForwardByMeters() and
+ * rotateByRadians(). Lower limits give gentler starts and stops at the cost of
+ * taking longer to cover the same distance.
+ *
+ * @param acceleration        - forward acceleration limit in m/s^2
+ * @param angularAcceleration - angular acceleration limit in rad/s^2
+ * @param jerk                - forward jerk limit in m/s^3. 0 or less gives trapezoidal profiles
+ * @param angularJerk         - angular jerk limit in rad/s^3. 0 or less gives trapezoidal profiles
+ */
+void Robot::setMotionLimits(double acceleration, double angularAcceleration, double jerk, double angularJerk)
+{
+  maxAcceleration        = acceleration;
+  maxAngularAcceleration = angularAcceleration;
+  maxJerk                = jerk;
+  maxAngularJerk         = angularJerk;
+}
+
+/**
+ * Reads in this robot's calibration if it has one. Each robot is told apart by
+ * the server it is on and the index of its devices.
+ *
+ * @param index - index of the robot's devices on the server
+ */
+void Robot::loadCalibration(int index)
+{
+  calibrationFile = "calibration-" + robot.GetHostname() + "-" + std::to_string(robot.GetPort()) +
+                    "-" + std::to_string(index) + ".txt";
+
+  if (calibration.readCalibration(calibrationFile))
+  {
+    std::cout << "Loaded calibration from " << calibrationFile << "\n";
+  }
+}
+
+/**
+ * Sends a fixed command and measures how fast the robot really moves. The
+ * robot is given a few ticks to get up to speed before measuring starts.
+ *
+ * @param command    - velocity to send in m/s or rad/s
+ * @param amount     - distance or angle to measure over in meters or radians
+ * @param isRotation - true to rotate in place, false to move forward
+ * @param measured   - set to the velocity the robot really moved at
+ * @return true if the measurement finished. False if a bumper was pressed
+ */
+bool Robot::measureVelocity(double command, double amount, bool isRotation, double& measured)
+{
+  unsigned long startBumperEvents = bumperEventCount;
+  double        duration          = amount / fabs(command);
+
+  if (isRotation) sendSpeed(0, command);
+  else            sendSpeed(command, 0);
+
+  restartLoop();
+  for (int i = 0; i < CALIBRATION_SETTLE_TICKS; i++) read();
+
+  Vector2 startPos = getPos();
+  double  startYaw = getYaw(),
+          lastYaw  = startYaw,
+          turned   = 0,
+          elapsed  = 0;
+
+  bool isBumped = false;
+  while (elapsed < duration && !isBumped)
+  {
+    read();
+    elapsed += state->dt;
+    turned  += clampYawToPi(getYaw() - lastYaw);
+    lastYaw  = getYaw();
+    isBumped = isAnyPressed() || bumperEventCount != startBumperEvents;
+  }
+
+  // stop and let the robot come to rest before the next measurement
+  sendSpeed(0, 0);
+  for (int i = 0; i < CALIBRATION_SETTLE_TICKS; i++) read();
+
+  if (isBumped || elapsed <= 0) return false;
+
+  Vector2 endPos = getPos();
+  measured = isRotation ? turned / elapsed :
+             ((endPos.x - startPos.x) * cos(startYaw) + (endPos.y - startPos.y) * sin(startYaw)) / elapsed;
+  return true;
+}
+
+/**
+ * Measures how fast the robot really moves and turns for a few different
+ * commands and fits the scale and bias that make it move as asked. Each
+ * command is tested forwards then backwards, and clockwise then
+ * counter-clockwise, so the robot ends up about where it started. The result
+ * is saved and loaded again whenever this robot is created.
+ *
+ * @param distance - distance to measure each forward velocity over in meters
+ * @param angle    - angle to measure each angular velocity over in radians
+ * @return true if every test finished and the fit made sense. False leaves the calibration unchanged
+ */
+bool Robot::calibrate(double distance, double angle)
+{
+  std::vector<double> moveCommands,   moveMeasured,
+                      rotateCommands, rotateMeasured;
+  double measured;
+
+  for (int i = 1; i <= CALIBRATION_TEST_COUNT; i++)
+  {
+    for (int direction = 1; direction >= -1; direction -= 2)
+    {
+      double command = direction * CALIBRATION_VELOCITY * i / CALIBRATION_TEST_COUNT;
+      if (!measureVelocity(command, distance, false, measured)) return false;
+      moveCommands.push_back(command);
+      moveMeasured.push_back(measured);
+
+      command = direction * CALIBRATION_ANGULAR_VELOCITY * i / CALIBRATION_TEST_COUNT;
+      if (!measureVelocity(command, angle, true, measured)) return false;
+      rotateCommands.push_back(command);
+      rotateMeasured.push_back(measured);
+    }
+  }
+
+  MotionCalibration fitted;
+  if (!fitMotionCalibration(moveCommands,   moveMeasured,   fitted.movementScale, fitted.movementBias) ||
+      !fitMotionCalibration(rotateCommands, rotateMeasured, fitted.rotationScale, fitted.rotationBias))
+  {
+    return false;
+  }
+
+  calibration = fitted;
+  printf("Movement scale %.3f bias %.3f m/s, rotation scale %.3f bias %.3f rad/s\n",
+         calibration.movementScale, calibration.movementBias,
+         calibration.rotationScale, calibration.rotationBias);
+
+  if (!calibration.writeCalibration(calibrationFile))
+  {
+    std::cout << "Could not save calibration to " << calibrationFile << "\n";
+  }
+
+  return true;
+}
+
+/** @return the scales and biases applied to every velocity command during moves */
+const MotionCalibration& Robot::getCalibration() const
+{
+  return calibration;
+}
+
 /**
  * Enable or disable the robot's motor
  *
@@ -448,6 +1253,7 @@ void Robot::localize()
  */ 
 void Robot::setMotorEnable(bool isMotorEnabled)
 {
+  std::lock_guard<std::mutex> lock(clientMutex);
   pp.SetMotorEnable(isMotorEnabled);
 }
 
@@ -461,13 +1267,10 @@ void Robot::setMotorEnable(bool isMotorEnabled)
  */
 bool Robot::moveForwardByMeters(double distanceInMeters, double forwardVelocity)
 {
-  // scale movement
-  distanceInMeters *= MOVEMENT_SCALE;
+  // a negative velocity moves backwards just like a negative distance
+  if (forwardVelocity < 0) distanceInMeters *= -1;
 
-  int ticks;
-  getFinalTicksAndVelocity(distanceInMeters, forwardVelocity, ticks);
-
-  return moveAndRotateOverTicks(forwardVelocity, 0, ticks);
+  return followProfile(distanceInMeters, fabs(forwardVelocity), false);
 }
 
 /**
@@ -480,13 +1283,10 @@ bool Robot::moveForwardByMeters(double distanceInMeters, double forwardVelocity)
  */ 
 bool Robot::rotateByRadians(double radiansToRotate, double angularVelocity)
 {
-  // scale rotation
-  radiansToRotate *= ROTATION_SCALE;
-
-  int ticks;
-  getFinalTicksAndVelocity(radiansToRotate, angularVelocity, ticks);
+  // a negative angular velocity rotates clockwise just like a negative angle
+  if (angularVelocity < 0) radiansToRotate *= -1;
 
-  return moveAndRotateOverTicks(0, angularVelocity, ticks);
+  return followProfile(radiansToRotate, fabs(angularVelocity), true);
 }
 
 /**
@@ -498,10 +1298,12 @@ bool Robot::rotateByRadians(double radiansToRotate, double angularVelocity)
  */ 
 void Robot::dislodgeFromObstacle(double distance, double velocity)
 {
-  // backup by given distance in order to dislodge the robot
+  // backup by given distance in order to dislodge the robot. This may be called by
+  // a bumper handler, in which case the robot must still be handling the bump after
+  bool wasHandlingBump = isHandlingBump;
   isHandlingBump = true;
   moveForwardByMeters(-distance, velocity);
-  isHandlingBump = false;
+  isHandlingBump = wasHandlingBump;
 }
 
 /**
@@ -529,7 +1331,7 @@ void Robot::setSpeed(double forwardVelocity, double angularVelocity, TurnDirecti
       break;
   }
 
-  pp.SetSpeed(forwardVelocity, angularVelocity);
+  sendSpeed(forwardVelocity, angularVelocity);
 }
 
 /**
@@ -542,7 +1344,7 @@ void Robot::setSpeed(double forwardVelocity, double angularVelocity, TurnDirecti
  */ 
 bool Robot::hasReachedWaypoint(Vector2& wp, double errorRange)
 {
-  Vector2 pos = getPos();
+  Vector2 pos = getPredictedPos();
 
   // return true if reached the waypoint within the error range
   return (pos.x + errorRange > wp.x && pos.x - errorRange < wp.x) &&
@@ -559,39 +1361,22 @@ bool Robot::hasReachedWaypoint(Vector2& wp, double errorRange)
  */ 
 void Robot::rotateToFaceWaypoint(Vector2& wp, double angularVelocity, double errorRange)
 {
-  double yawPrediction,   // the predicted final yaw of the robot
-         actualYaw,       // the actual final yaw of the robot
-         radiansToRotate, // the number of radians to rotate to face the waypoint
-         maxAngVelocity;  // the maximum velocity for the robot to rotate
+  TIME_STAGE(ProfileStage::RotateToFace);
 
-  // by default, the given angularVelocity if the maximum velocity for the robot to rotate
-  maxAngVelocity = angularVelocity;
+  double radiansToRotate; // the number of radians to rotate to face the waypoint
 
-  // continuously rotate the robot until it is facing the waypoint as close as possible
+  // each pass follows a full motion profile so a single pass is normally enough. Another is
+  // only needed if the rotation was interrupted or localization disagrees with the odometer.
+  // The last read is used to begin with, after that each pass reads once when it stops
   while (1)
   {
-    // determine how much the robot must rotate what its final rotation should be
-    robot.Read();
     radiansToRotate = getAngleToWaypoint(wp);
-    yawPrediction   = clampYawToPi(getYaw() + radiansToRotate);
-
-    // if the robot is unable to complete it's rotation, reset angular velocity and continue
-    if (!rotateByRadians(radiansToRotate, angularVelocity))
-    {
-      angularVelocity = maxAngVelocity;
-      continue;
-    }
-
-    // obtain the actual final yaw
-    robot.Read();
-    actualYaw = getYaw();
 
-    // break if the robot is reasonably close to it's predicted yaw
-    if (actualYaw >= yawPrediction - errorRange &&
-        actualYaw <= yawPrediction + errorRange) break;
+    // break if the robot is reasonably close to facing the waypoint or the motion was cancelled
+    if (fabs(radiansToRotate) <= errorRange || isCancelRequested) break;
 
-    // halve the angular velocity to ensure the robot will eventually face the waypoint
-    angularVelocity *= 0.5;
+    rotateByRadians(radiansToRotate, angularVelocity);
+    read();
   }
   std::cout << "\n";
 }
@@ -611,28 +1396,303 @@ void Robot::moveToWaypoint(Vector2& wp,
                            double angularVelocity,
                            double errorRange)
 {
-  // the max velocity that the robot can travel at
-  double maxVelocity = velocity;
-
   targetWaypoint = &wp;
 
+  // bumps are handled the moment they are read
+  addBumperHandler(&bumperEventState);
+
   // move to waypoint wp until within the error range
   while (1)
   { 
-    robot.Read();
-    if(hasReachedWaypoint(wp, errorRange)) break;
+    read();
+    if(hasReachedWaypoint(wp, errorRange) || isCancelRequested) break;
 
     // face towards the waypoint
     rotateToFaceWaypoint(wp, angularVelocity);
 
-    // if the robot was able to complete its movement, halve the velocity. Otherwise, reset it
-    velocity = moveForwardByMeters(getDistanceToWaypoint(wp), velocity) ? velocity * 0.5 : maxVelocity;
- 
-    // handle any bumper events
-    bumperEventState.handleBump(this);
+    // drive the whole distance in one pass. This only repeats if the robot was interrupted
+    moveForwardByMeters(getDistanceToWaypoint(wp), velocity);
+
+    // a bumper that was already held down when the move started never produces an edge
+    if (isAnyPressed()) bumperEventState.handleBump(this);
+  }
+
+  removeBumperHandler(&bumperEventState);
+  targetWaypoint = NULL;
+}
+
+/**
+ * The robot drives along the whole series of waypoints without stopping, using
+ * pure pursuit to steer towards a point a little further along the path every
+ * tick. It slows down for sharp turns and for the end of the path.
+ *
+ * With the DynamicWindow tracker the robot heads for the same point on the
+ * path, but the dynamic window planner picks the command each tick so the
+ * robot swerves around obstacles the map did not know about. The Predictive
+ * tracker rolls out hundreds of candidate trajectories along the path every
+ * tick instead, which keeps the robot on the path at speeds where pure
+ * pursuit would cut corners.
+ *
+ * @param waypoints        - the waypoints for the robot to follow in order
+ * @param bumperEventState - how the robot should respond to bumpers being pressed
+ * @param velocity         - top velocity for the robot to move in m/s
+ * @param angularVelocity  - top angular velocity for the robot to rotate in rad/s
+ * @param errorRange       - minimum distance robot must be from the final waypoint in meters
+ * @param tracker          - how the robot steers along the path
+ */ 
+void Robot::followPath(const std::vector<Vector2>& waypoints,
+                       BumperEventState& bumperEventState,
+                       double velocity,
+                       double angularVelocity,
+                       double errorRange,
+                       PathTracker::Enum tracker)
+{
+  if (waypoints.empty()) return;
+
+  // the path starts from wherever the robot is right now
+  restartLoop();
+  read();
+  std::vector<Vector2> path(1, getPos());
+  path.insert(path.end(), waypoints.begin(), waypoints.end());
+
+  PurePursuit          pursuit(path);
+  DynamicWindowPlanner planner(velocity, angularVelocity, maxAcceleration, maxAngularAcceleration);
+  PredictiveController controller(velocity, angularVelocity, maxAcceleration, maxAngularAcceleration, TICK_INTERVAL);
+  Vector2              goal  = waypoints.back(),
+                       ahead = waypoints.front(); // where a bumper handler should head for
+  double               speed = 0,
+                       turn  = 0;
+
+  // bumps are handled the moment they are read
+  targetWaypoint = &ahead;
+  addBumperHandler(&bumperEventState);
+  unsigned long lastBumperEvents = bumperEventCount;
+
+  while (!hasReachedWaypoint(goal, errorRange) && !isCancelRequested)
+  {
+    // a bumper that was already held down never produces an edge, so stop and handle it here
+    if (isAnyPressed())
+    {
+      sendSpeed(0, 0);
+      bumperEventState.handleBump(this);
+      read();
+    }
+
+    // start again from rest after the robot has been moved by a bumper handler
+    if (bumperEventCount != lastBumperEvents || isAnyPressed())
+    {
+      lastBumperEvents = bumperEventCount;
+      speed = 0;
+      turn  = 0;
+      controller.reset();
+      continue;
+    }
+
+    Vector2 pos;
+    double  curvature;
+    {
+      TIME_STAGE(ProfileStage::Localize);
+      pos = getPos();
+    }
+
+    // slow down when nearing the goal and whenever turning faster than allowed
+    {
+      TIME_STAGE(ProfileStage::Decide);
+      curvature = pursuit.getCurvature(pos, getYaw(), speed);
+      ahead     = pursuit.getLookaheadPoint();
+
+      if (tracker == PathTracker::Predictive)
+      {
+        // stop rather than run into something
+        if (!getPredictiveCommand(controller, pursuit, velocity, speed, turn))
+        {
+          speed = 0;
+          turn  = 0;
+        }
+      }
+      else if (tracker == PathTracker::DynamicWindow)
+      {
+        getDynamicWindowCommand(planner, pursuit.getLookaheadPoint(), angularVelocity, speed, turn);
+
+        // keep to the same arc while slowing down for the end of the path
+        double slowest = pursuit.getRemainingDistance(pos) * PATH_SLOWDOWN_GAIN;
+        if (speed > slowest)
+        {
+          turn  *= slowest / speed;
+          speed  = slowest;
+        }
+      }
+      else if (pursuit.isLookaheadBehind())
+      {
+        // no forward arc reaches a point behind the robot, so turn to face it first
+        speed = 0;
+        turn  = pursuit.getLookaheadBearing() < 0 ? -angularVelocity : angularVelocity;
+      }
+      else
+      {
+        // head for the pursuit speed no faster than the base can change speed
+        double target = std::min(velocity, pursuit.getRemainingDistance(pos) * PATH_SLOWDOWN_GAIN),
+               change = maxAcceleration * state->dt;
+        speed = std::max(speed - change, std::min(speed + change, target));
+
+        if (fabs(speed * curvature) > angularVelocity) speed = angularVelocity / fabs(curvature);
+        turn  = speed * curvature;
+      }
+    }
+
+    sendSpeed(speed, turn);
+    read();
   }
 
+  // stop moving
+  sendSpeed(0, 0);
+  removeBumperHandler(&bumperEventState);
   targetWaypoint = NULL;
+
+  if (tracker == PathTracker::Predictive)
+  {
+    printf("Predictive controller: %.0f rollouts per ms\n", controller.getRolloutsPerMillisecond());
+  }
+}
+
+/** @return the monitor watching for wheel slip and localization jumps during moves */
+const MotionMonitor& Robot::getMotionMonitor() const
+{
+  return motionMonitor;
+}
+
+/**
+ * @return the waypoint moveToWaypoint() is heading for, or the lookahead point
+ *         of followPath(). NULL if neither is running
+ */
+const Vector2* Robot::getTargetWaypoint() const
+{
+  return targetWaypoint;
+}
+
+/**
+ * Asks the dynamic window planner for the next command using the latest laser
+ * scan. When every command would run into something the robot turns in place
+ * towards the goal instead, which sooner or later opens up a way out.
+ *
+ * @param planner            - the planner to ask
+ * @param goal               - point to head towards in world coordinates
+ * @param maxAngularVelocity - angular velocity to turn in place at in rad/s
+ * @param forwardVelocity    - the velocity last sent, set to the velocity to send next
+ * @param angularVelocity    - the angular velocity last sent, set to the angular velocity to send next
+ */
+void Robot::getDynamicWindowCommand(DynamicWindowPlanner& planner,
+                                    Vector2 goal,
+                                    double maxAngularVelocity,
+                                    double& forwardVelocity,
+                                    double& angularVelocity)
+{
+  // the planner works in the robot's frame: x is straight ahead and y is to the left
+  Vector2 pos = getPos();
+  double  yaw = getYaw(),
+          dx  = goal.x - pos.x,
+          dy  = goal.y - pos.y;
+  Vector2 localGoal( cos(yaw) * dx + sin(yaw) * dy,
+                    -sin(yaw) * dx + cos(yaw) * dy);
+
+  planner.setScan(state->laserRanges, state->laserBearings, state->laserMaxRange);
+  // the acceleration window covers however long the last tick really took
+  if (planner.getCommand(forwardVelocity, angularVelocity, localGoal, state->dt,
+                         forwardVelocity, angularVelocity)) return;
+
+  forwardVelocity = 0;
+  angularVelocity = localGoal.y < 0 ? -maxAngularVelocity : maxAngularVelocity;
+}
+
+/**
+ * Asks the predictive controller for the next command. The reference it tracks
+ * runs along the path from the point closest to the robot, speeding up from
+ * the current velocity as fast as the robot can and slowing down in time to
+ * stop at the end of the path.
+ *
+ * @param controller      - the controller to ask
+ * @param pursuit         - the path, as of its last call to getCurvature()
+ * @param velocity        - top velocity along the path in m/s
+ * @param forwardVelocity - the velocity last sent, set to the velocity to send next
+ * @param angularVelocity - the angular velocity last sent, set to the angular velocity to send next
+ * @return true if the command keeps the robot clear of every obstacle
+ */
+bool Robot::getPredictiveCommand(PredictiveController& controller,
+                                 const PurePursuit& pursuit,
+                                 double velocity,
+                                 double& forwardVelocity,
+                                 double& angularVelocity)
+{
+  Vector2 pos       = getPos();
+  double  yaw       = getYaw(),
+          remaining = pursuit.getRemainingDistance(pos),
+          travelled = 0,
+          speed     = forwardVelocity,
+          dt        = state->dt; // steps last as long as the last tick really did
+
+  controller.setStepTime(dt);
+
+  // where the robot should be after each step, in the robot's frame
+  std::vector<Vector2> reference(PredictiveController::HORIZON);
+  for (int i = 0; i < PredictiveController::HORIZON; i++)
+  {
+    speed = std::min(std::min(velocity, speed + maxAcceleration * dt),
+                     sqrt(2.0 * maxAcceleration * std::max(0.0, remaining - travelled)));
+    travelled += speed * dt;
+
+    Vector2 point = pursuit.getPointAhead(pos, travelled);
+    double  dx    = point.x - pos.x,
+            dy    = point.y - pos.y;
+    reference[i] = Vector2( cos(yaw) * dx + sin(yaw) * dy,
+                           -sin(yaw) * dx + cos(yaw) * dy);
+  }
+
+  controller.setScan(state->laserRanges, state->laserBearings, state->laserMaxRange);
+  return controller.getCommand(forwardVelocity, angularVelocity, reference,
+                               forwardVelocity, angularVelocity);
+}
+
+/**
+ * The robot heads for the goal while steering around anything its laser sees,
+ * using the dynamic window planner to pick the command every tick. It stops
+ * early if a bumper is pressed.
+ *
+ * @param goal            - the point to move to
+ * @param tickDuration    - the most ticks to spend getting there
+ * @param velocity        - top velocity for the robot to move in m/s
+ * @param angularVelocity - top angular velocity for the robot to rotate in rad/s
+ * @param errorRange      - minimum distance robot must be from the goal in meters
+ * @return true if the robot reached the goal
+ */
+bool Robot::moveWithDynamicWindow(Vector2 goal,
+                                  int    tickDuration,
+                                  double velocity,
+                                  double angularVelocity,
+                                  double errorRange)
+{
+  DynamicWindowPlanner planner(velocity, angularVelocity, maxAcceleration, maxAngularAcceleration);
+  double speed = 0,
+         turn  = 0;
+  bool   hasReachedGoal = false;
+
+  restartLoop();
+  for (int i = 0; i < tickDuration; i++)
+  {
+    read();
+
+    hasReachedGoal = hasReachedWaypoint(goal, errorRange);
+    if (hasReachedGoal || isAnyPressed() || isCancelRequested) break;
+
+    {
+      TIME_STAGE(ProfileStage::Decide);
+      getDynamicWindowCommand(planner, goal, angularVelocity, speed, turn);
+    }
+
+    sendSpeed(speed, turn);
+  }
+
+  sendSpeed(0, 0);
+  return hasReachedGoal;
 }
 
 /**
@@ -647,19 +1707,22 @@ void Robot::autoPilotLaser(int tickDuration, double forwardVelocity, double angu
 {
   if (!sp || tickDuration <= 0) return;
 
+  TIME_STAGE(ProfileStage::AutoPilot);
+
   double minLeft, minRight; // length of left and right laser
   TurnDirection::Enum dir;  // direction the robot should turn
 
+  restartLoop();
   for (int i = 0; i < tickDuration; i++)
   {
-    robot.Read();
+    read();
 
     // get min left and right data from the laser
-    minLeft  = sp->MinLeft();
-    minRight = sp->MinRight();
+    minLeft  = state->laserMinLeft;
+    minRight = state->laserMinRight;
 
-    // reached a dead end, stop moving
-    if (minLeft < 0.30 && minRight < 0.30) break;
+    // reached a dead end or the motion was cancelled, stop moving
+    if ((minLeft < 0.30 && minRight < 0.30) || isCancelRequested) break;
 
     // determine the direction to rotate
     dir = minRight < minLeft ? TurnDirection::Left : TurnDirection::Right;
@@ -683,6 +1746,18 @@ BumperEventState::BumperEventState(double distance,
     velocity(velocity),
     angularVelocity(angularVelocity) {}
 
+/**
+ * Called by the robot as soon as a read sees a bumper get pressed or released.
+ * By default the robot corrects its position on any press and ignores releases.
+ *
+ * @param robot - the robot whose bumper changed
+ * @param event - the bumpers that changed and the snapshot they changed in
+ */
+void BumperEventState::onBumperEvent(Robot *robot, const BumperEvent& event)
+{
+  if (event.pressed) handleBump(robot);
+}
+
 /**
  * Constructor for a new SimbleBumper object
  *
@@ -732,9 +1807,10 @@ AutoPilot::AutoPilot(int    ticks,
  */ 
 void SimpleBumper::handleBump(Robot *robot)
 {
-  robot->read();
   if (!robot->isAnyPressed()) return;
 
+  TIME_STAGE(ProfileStage::HandleBump);
+
   // turning right by default
   TurnDirection::Enum dir = right;
 
@@ -769,9 +1845,10 @@ void SimpleBumper::handleBump(Robot *robot)
 void AutoPilot::handleBump(Robot *robot)
 {
   // if no bumpers were pressed, return
-  robot->read();
   if (!robot->isAnyPressed()) return;
 
+  TIME_STAGE(ProfileStage::HandleBump);
+
   // backup from the obstacle
   robot->dislodgeFromObstacle(distance, velocity);
 
@@ -779,3 +1856,47 @@ void AutoPilot::handleBump(Robot *robot)
   robot->autoPilotLaser(ticks, velocity, angularVelocity);
 }
 
+/**
+ * Constructor for a new DynamicWindowRecovery object
+ *
+ * @param ticks           - the number of ticks to steer around the obstacle for
+ * @param distance        - the distance the robot should backup
+ * @param velocity        - the velocity of the robot
+ * @param angularVelocity - the angular velocity of the robot
+ */
+DynamicWindowRecovery::DynamicWindowRecovery(int    ticks,
+                                             double distance,
+                                             double velocity,
+                                             double angularVelocity) :
+    BumperEventState(distance, velocity, angularVelocity),
+    ticks(ticks) {}
+
+/**
+ * Handles bumper events by having the robot back up and then steer around
+ * the obstacle with the dynamic window planner. The robot heads for the
+ * waypoint it was moving to, or the lookahead point of the path it was
+ * following, or for a point a meter straight ahead if it was doing neither.
+ *
+ * @param Pointer to the robot that is correcting its position.
+ */
+void DynamicWindowRecovery::handleBump(Robot *robot)
+{
+  if (!robot->isAnyPressed()) return;
+
+  TIME_STAGE(ProfileStage::HandleBump);
+
+  // backup from the obstacle
+  robot->dislodgeFromObstacle(distance, velocity);
+
+  Vector2 goal;
+  if (robot->getTargetWaypoint()) goal = *robot->getTargetWaypoint();
+  else
+  {
+    Vector2 pos = robot->getPos();
+    double  yaw = robot->getYaw();
+    goal = Vector2(pos.x + cos(yaw), pos.y + sin(yaw));
+  }
+
+  // steer around the obstacle
+  robot->moveWithDynamicWindow(goal, ticks, velocity, angularVelocity);
+}
@@ -7,10 +7,26 @@
 
 #include <libplayerc++/playerc++.h>
 #include <cmath>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 #include "Vector2.h"
+#include "ControlLoop.h"
+#include "TripleBuffer.h"
+#include "MotionMonitor.h"
+#include "MotionCalibration.h"
+#include "PoseFilter.h"
+#include "PosePredictor.h"
 
 // forward declarations
 class BumperEventState;
+class DynamicWindowPlanner;
+class PredictiveController;
+class PurePursuit;
+class RobotTeam;
 
 /**
  * Enum used to represent a direction for the robot to turn.
@@ -25,56 +41,223 @@ namespace TurnDirection
 }
 
 /**
- * The method the robot should use to determine where it is
+ * The method the robot should use to determine where it is. Fused moves with
+ * the odometer every tick and is pulled towards localization whenever it has
+ * a new estimate.
  */
 namespace PositionMethod
 {
-  enum Enum { Localization, Odometry };
+  enum Enum { Localization, Odometry, Fused };
 }
 
+/**
+ * How followPath() steers along the path. PurePursuit follows the path itself,
+ * DynamicWindow heads for the same point on the path but steers around
+ * anything the laser sees on the way, and Predictive looks a couple of seconds
+ * ahead along the path so it can track it closely at high speed.
+ */
+namespace PathTracker
+{
+  enum Enum { PurePursuit, DynamicWindow, Predictive };
+}
+
+/**
+ * Bumpers as bits so that edges on both sides can be told apart from edges on
+ * just one side. Both is Left | Right.
+ */
+namespace BumperSide
+{
+  enum Enum { None = 0, Left = 1, Right = 2, Both = 3 };
+}
+
+/**
+ * Everything read from the proxies by a single call to Robot::read(). Every
+ * decision made during a tick works off of the same snapshot, so the server
+ * only has to be waited on once per tick.
+ */
+struct RobotState
+{
+  unsigned long generation; // number of reads that came before this one
+  double        timestamp;  // time the data was taken by the server in seconds
+  double        dt;         // measured time since the previous read in seconds
+  double        captureTime; // monotonic time the snapshot was taken in seconds
+  double        readLatency; // estimated time between the server taking the data and captureTime
+
+  // odometry
+  Vector2 odometerPos;
+  double  odometerYaw;
+
+  // bumpers
+  bool isLeftPressed,
+       isRightPressed,
+       isAnyPressed;
+
+  // every hypothesis given by the localize proxy, most likely first
+  std::vector<player_localize_hypoth_t> hypotheses;
+  double hypothesisWeight; // sum of the weights of every hypothesis
+
+  // odometry and localization fused by the robot's pose filter
+  Vector2 fusedPos;
+  double  fusedYaw;
+  double  fusedCovariance[3][3]; // of x, y and yaw
+
+  // laser data. Left empty if the robot has no laser
+  std::vector<double> laserRanges,
+                      laserBearings;
+  double laserMaxRange,
+         laserMinLeft,
+         laserMinRight;
+
+  RobotState();
+};
+
+/**
+ * Bumper edges seen by a single read, handed to every registered
+ * BumperEventState as soon as they are seen.
+ */
+struct BumperEvent
+{
+  int pressed,      // BumperSide bits that went from released to pressed
+      released;     // BumperSide bits that went from pressed to released
+  RobotState state; // the snapshot the edges were seen in
+
+  bool isPressed(BumperSide::Enum side) const  { return (pressed  & side) == side; }
+  bool isReleased(BumperSide::Enum side) const { return (released & side) == side; }
+};
+
 /**
  * Wrapper class used to simplify use of the Robot
  */ 
 class Robot
 {
-  PlayerCc::PlayerClient    robot;
+  friend class RobotTeam;
+
+  std::unique_ptr<PlayerCc::PlayerClient> ownClient; // the client when the robot has one of its own
+  PlayerCc::PlayerClient   &robot;      // client the proxies talk through, possibly shared with a team
+  RobotTeam                *team;       // team that reads for this robot, or NULL if it reads for itself
   PlayerCc::Position2dProxy pp;         // The 2D proxy is used to send motion commands.
   PlayerCc::BumperProxy     bp;         // The bumper proxy reads from the bumpers.
   PlayerCc::LocalizeProxy   lp;         // Used to control a localize device for localization
   PlayerCc::LaserProxy     *sp;         // Laser proxy used to scan the environment
   bool isHandlingBump;                  // true if the robot is currently correcting its position due to a bumper press
   PositionMethod::Enum posMethod;       // the default way for the robot to determine it's location
-  Vector2 *targetWaypoint;              // used to make sure the robot does not overshoot its movement
+  Vector2 *targetWaypoint;              // used to make sure the robot does not overshoot its movement, and by bumper handlers
+  RobotState ownState;                  // snapshot storage when the robot is not part of a team
+  RobotState *state;                    // snapshot of the proxies as of the last read
+  ControlLoop loop;                     // paces reads at the tick interval
+  unsigned long captureCount;           // number of snapshots taken so far
+  MotionMonitor motionMonitor;          // watches moves for wheel slip and localization jumps
+  PoseFilter poseFilter;                // fuses odometry and localization every capture
+  PosePredictor predictor;              // brings stale poses up to date
+  player_pose2d_t lastHypothesisMean;   // best localization estimate as of the last capture
+
+  // bumper events
+  std::vector<BumperEventState*> bumperHandlers;      // told about every bumper edge
+  std::vector<BumperEvent>       pendingBumperEvents; // edges seen but not yet handed to the handlers
+  int                            lastBumperSides;     // BumperSide bits pressed as of the last read
+  unsigned long                  bumperEventCount;    // edges seen so far, including ones still pending
+  bool                           isDispatching;       // true while handlers are being told about an edge
+
+  // background reading
+  std::thread              readerThread;       // takes snapshots while running
+  std::atomic<bool>        isReaderRunning;    // true while readerThread owns reading
+  std::mutex               clientMutex;        // held whenever the client is used
+  TripleBuffer<RobotState> snapshots;          // hands snapshots from readerThread to read()
+  double                   snapshotLatency,    // latency of the last snapshot handed over
+                           snapshotLatencySum, // sum of every snapshot's latency
+                           maxSnapshotLatency; // largest latency of any snapshot
+  unsigned long            snapshotCount;      // number of snapshots handed over
+
+  // control from other threads
+  std::atomic<bool>                       isCancelRequested; // true while motions should stop early
+  std::function<void(const RobotState&)> readListener;      // told about every snapshot read
+
+  // limits used when building motion profiles
+  double maxAcceleration,        // m/s^2
+         maxAngularAcceleration, // rad/s^2
+         maxJerk,                // m/s^3, or 0 for trapezoidal profiles
+         maxAngularJerk;         // rad/s^3, or 0 for trapezoidal profiles
 
   // tick interval of the robot
   const double TICK_INTERVAL;
 
   // scale movement and rotation of the robot to ensure accurate locomotion
-  const double MOVEMENT_SCALE,
-               ROTATION_SCALE;
+  MotionCalibration calibration;
+  std::string       calibrationFile; // where this robot's calibration is kept
+
+  // copies the proxies into a snapshot
+  void captureState(RobotState& snapshot, double readLatency = 0);
+
+  // background reading
+  void runReader();
+
+  // times the next tick as the first of a new motion
+  void restartLoop();
+
+  // tells the handlers about any bumper edges in the latest snapshot
+  void dispatchBumperEvents();
+
+  // sends velocity commands
+  void sendSpeed(double forwardVelocity, double angularVelocity);
 
   // movement
-  bool moveAndRotateOverTicks(double forwardVelocity, double angularVelocity, int ticks);
-  void getFinalTicksAndVelocity(double distance, double& velocity, int& ticks);
+  bool followProfile(double distance, double velocity, bool isRotation);
+
+  // calibration
+  void loadCalibration(int index);
+  bool measureVelocity(double command, double amount, bool isRotation, double& measured);
 
   // waypoint movement
   double getAngleToWaypoint(Vector2& wp);
   double getDistanceToWaypoint(Vector2& wp);
 
+  // local planning
+  void getDynamicWindowCommand(DynamicWindowPlanner& planner,
+                               Vector2 goal,
+                               double maxAngularVelocity,
+                               double& forwardVelocity,
+                               double& angularVelocity);
+  bool getPredictiveCommand(PredictiveController& controller,
+                            const PurePursuit& pursuit,
+                            double velocity,
+                            double& forwardVelocity,
+                            double& angularVelocity);
+
 public:
   // constructor
   Robot(bool   isUsingLaser            = true,
         double movementScale           = 1.0,
         double rotationScale           = 1.0,
-        PositionMethod::Enum posMethod = PositionMethod::Localization,
+        PositionMethod::Enum posMethod = PositionMethod::Fused,
         double tickInterval            = 0.1,
         std::string hostname           = "localhost");
+  Robot(RobotTeam& team,
+        int    index,
+        bool   isUsingLaser            = true,
+        double movementScale           = 1.0,
+        double rotationScale           = 1.0,
+        PositionMethod::Enum posMethod = PositionMethod::Fused);
 
   // destructor
   ~Robot();
 
   // read from the environment
   void read();
+  const RobotState& getState() const;
+  const ControlLoop& getControlLoop() const;
+
+  // read from the environment on a background thread
+  void startReaderThread();
+  void stopReaderThread();
+  double getSnapshotLatency() const;
+  double getMeanSnapshotLatency() const;
+  double getMaxSnapshotLatency() const;
+
+  // control from other threads
+  void cancelMotion();
+  void clearCancel();
+  bool isMotionCancelled() const;
+  void setReadListener(std::function<void(const RobotState&)> listener);
 
   // utility
   double clampYawToPi(double yaw);
@@ -87,16 +270,35 @@ public:
   Vector2 getLocalizedPos();
   double getLocalizedYaw();
 
+  // get position based on odometry and localization fused together
+  Vector2 getFusedPos();
+  double getFusedYaw();
+  void getPoseCovariance(double covariance[3][3]) const;
+
+  // get position brought forward from the last read to right now
+  Vector2 getPredictedPos();
+  double getPredictedYaw();
+  void getPredictedPose(Vector2& pos, double& yaw);
+
   // obtains the robot's position depending on the posMethod member variable
   Vector2 getPos();
   double getYaw();
 
+  // bumper events
+  void addBumperHandler(BumperEventState *handler);
+  void removeBumperHandler(BumperEventState *handler);
+  unsigned long getBumperEventCount() const;
+
   // get status of bumpers
   bool isLeftPressed();
   bool isRightPressed();
   bool isBothPressed();
   bool isAnyPressed();
 
+  // get data from the laser
+  bool getLaserScan(std::vector<double>& ranges, std::vector<double>& bearings);
+  double getMaxLaserRange();
+
   // print information about the robot
   void printOdometerPosition();
   void printLocalizedPosition();
@@ -105,18 +307,30 @@ public:
   void printLaserData();
   
   // get the best Hypothesis from the LocalizeProxy 
-  player_localize_hypoth_t getBestLocalizeHypothesis();
+  bool getBestLocalizeHypothesis(player_localize_hypoth_t& hypothesis) const;
+  const player_localize_hypoth_t* getTopHypotheses(int k, int& count) const;
+  double getTotalHypothesisWeight() const;
 
   // get the best pose from the LocalizeProxy
-  player_pose2d_t getPoseFromLocalizeProxy();
+  bool getPoseFromLocalizeProxy(player_pose2d_t& pose) const;
 
   // localizes the robot
+  bool isLocalized() const;
   void localize();
 
+  // calibration
+  bool calibrate(double distance = 1.0, double angle = M_PI / 2.0);
+  const MotionCalibration& getCalibration() const;
+
   // motor
   void setMotorEnable(bool isMotorEnabled);
+  void setMotionLimits(double acceleration,
+                       double angularAcceleration,
+                       double jerk        = 0,
+                       double angularJerk = 0);
 
   // handle basic movement
+  const MotionMonitor& getMotionMonitor() const;
   bool moveForwardByMeters(double distanceInMeters, double forwardVelocity = 0.5);
   bool rotateByRadians(double radiansToRotate, double angularVelocity = 0.5);
   void dislodgeFromObstacle(double distance, double velocity);
@@ -134,6 +348,20 @@ public:
                       double velocity        = 0.5,
                       double angularVelocity = 0.5,
                       double errorRange      = 0.25);
+  void followPath(const std::vector<Vector2>& waypoints,
+                  BumperEventState& bumperEventState,
+                  double velocity           = 0.5,
+                  double angularVelocity    = 1.0,
+                  double errorRange         = 0.25,
+                  PathTracker::Enum tracker = PathTracker::PurePursuit);
+  const Vector2* getTargetWaypoint() const;
+
+  // obstacle avoiding movement
+  bool moveWithDynamicWindow(Vector2 goal,
+                             int    tickDuration    = INT_MAX,
+                             double velocity        = 0.5,
+                             double angularVelocity = 1.0,
+                             double errorRange      = 0.25);
 
   // auto-pilot movement
   void autoPilotLaser(int tickDuration = INT_MAX, double forwardVelocity = 0.5, double angularVelocity = 1.0);
@@ -149,6 +377,7 @@ struct BumperEventState
   BumperEventState(double distance, double velocity, double angularVelocity);
 
   virtual void handleBump(Robot *robot) = 0;
+  virtual void onBumperEvent(Robot *robot, const BumperEvent& event);
 };
 
 /**
@@ -189,4 +418,21 @@ struct AutoPilot : public BumperEventState
   void handleBump(Robot *robot);
 };
 
+/**
+ * Corrects the robot's position by having it backup followed by steering
+ * around the obstacle with the dynamic window planner, heading for the
+ * waypoint the robot was moving to for a set number of ticks.
+ */
+struct DynamicWindowRecovery : public BumperEventState
+{
+  int ticks; // the number of ticks to steer around the obstacle for
+
+  DynamicWindowRecovery(int    ticks           = 50,
+                        double distance        = 0.5,
+                        double velocity        = 0.5,
+                        double angularVelocity = 1.0);
+
+  void handleBump(Robot *robot);
+};
+
 #endif
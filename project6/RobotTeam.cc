@@ -0,0 +1,212 @@
+#include "RobotTeam.h"
+#include "PurePursuit.h"
+#include "LatencyHistogram.h"
+#include <algorithm> // std::min
+#include <chrono>    // std::chrono::steady_clock
+#include <cmath>     // fabs, hypot
+
+// how quickly followPaths() slows each robot down for the end of its path, in m/s per meter left
+const double TEAM_SLOWDOWN_GAIN = 1.0;
+
+/**
+ * Connects to the server and sets up every robot in the team
+ *
+ * @param robotCount    - number of robots, using device indexes 0 to robotCount - 1
+ * @param isUsingLaser  - if true, every robot uses its laser
+ * @param movementScale - forward command per m/s wanted, until a robot is calibrated
+ * @param rotationScale - angular command per rad/s wanted, until a robot is calibrated
+ * @param posMethod     - the default way for each robot to determine its location
+ * @param tickInterval  - the interval that the whole team ticks at
+ * @param hostname      - address to connect to
+ * @param port          - port to connect to
+ */
+RobotTeam::RobotTeam(int    robotCount,
+                     bool   isUsingLaser,
+                     double movementScale,
+                     double rotationScale,
+                     PositionMethod::Enum posMethod,
+                     double tickInterval,
+                     std::string hostname,
+                     unsigned port) :
+  client(hostname, port),
+  loop(tickInterval),
+  states(robotCount)
+{
+  // only fetch data when asked for it, and only the newest, so reads follow our own tick rate
+  client.SetDataMode(PLAYER_DATAMODE_PULL);
+  client.SetReplaceRule(true);
+
+  // print how long each stage of the control loop took once the program ends
+  installStageLatencyDump();
+
+  // robots keep pointers into states, so it must never be resized after this
+  for (int i = 0; i < robotCount; i++)
+  {
+    robots.push_back(new Robot(*this, i, isUsingLaser, movementScale, rotationScale, posMethod));
+  }
+
+  // initial read to prevent segmentation defaults with proxies
+  read();
+}
+
+/** Destructor used to release memory. The robots go before the client they talk through */
+RobotTeam::~RobotTeam()
+{
+  for (int i = 0; i < (int)robots.size(); i++) delete robots[i];
+}
+
+/** @return number of robots in the team */
+int RobotTeam::getRobotCount() const
+{
+  return robots.size();
+}
+
+/**
+ * @param index - index of the robot
+ * @return the robot
+ */
+Robot& RobotTeam::getRobot(int index)
+{
+  return *robots[index];
+}
+
+/**
+ * @param index - index of the robot
+ * @return the robot's state as of the last read
+ */
+const RobotState& RobotTeam::getState(int index) const
+{
+  return states[index];
+}
+
+/** @return the control loop pacing the team's reads */
+const ControlLoop& RobotTeam::getControlLoop() const
+{
+  return loop;
+}
+
+/**
+ * Read from the environment for every robot. Waits for the next tick, fetches
+ * the newest data for the whole team in one go, snapshots every robot, then
+ * hands out any bumper edges. Handlers only run once every robot has its new
+ * snapshot, so a handler can look at the rest of the team.
+ */
+void RobotTeam::read()
+{
+  double dt = loop.waitForNextTick();
+
+  {
+    TIME_STAGE(ProfileStage::Read);
+
+    // the server took the data somewhere during the read, most likely halfway through
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    client.Read();
+    double readLatency = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / 2.0;
+
+    for (int i = 0; i < (int)robots.size(); i++)
+    {
+      robots[i]->captureState(states[i], readLatency);
+      states[i].dt = dt;
+    }
+  }
+
+  for (int i = 0; i < (int)robots.size(); i++) robots[i]->dispatchBumperEvents();
+}
+
+/** Stops every robot */
+void RobotTeam::stop()
+{
+  for (int i = 0; i < (int)robots.size(); i++) robots[i]->sendSpeed(0, 0);
+}
+
+/**
+ * Every robot drives along its own path at the same time, each steered by pure
+ * pursuit. The team reads once per tick however many robots there are. A
+ * robot stops where it is while one of its bumpers is pressed and carries on
+ * once it is released; robots that reach the end of their path wait there for
+ * the rest.
+ *
+ * @param paths           - the waypoints for each robot to follow, in the same order as the robots
+ * @param velocity        - top velocity for each robot to move in m/s
+ * @param angularVelocity - top angular velocity for each robot to rotate in rad/s
+ * @param errorRange      - minimum distance each robot must be from its final waypoint in meters
+ */
+void RobotTeam::followPaths(const std::vector<std::vector<Vector2> >& paths,
+                            double velocity,
+                            double angularVelocity,
+                            double errorRange)
+{
+  int count = std::min(paths.size(), robots.size());
+
+  // every path starts from wherever its robot is right now
+  std::vector<PurePursuit> trackers;
+  std::vector<Vector2>     goals;
+  std::vector<double>      speeds(count, 0);
+  std::vector<char>        isDone(count, 0);
+
+  loop.reset();
+  read();
+  for (int i = 0; i < count; i++)
+  {
+    std::vector<Vector2> path(1, robots[i]->getPos());
+    path.insert(path.end(), paths[i].begin(), paths[i].end());
+
+    trackers.push_back(PurePursuit(path));
+    goals.push_back(path.back());
+  }
+
+  int remaining = count;
+  while (remaining > 0)
+  {
+    for (int i = 0; i < count; i++)
+    {
+      if (isDone[i]) continue;
+
+      Robot& robot = *robots[i];
+
+      if (robot.hasReachedWaypoint(goals[i], errorRange))
+      {
+        robot.sendSpeed(0, 0);
+        isDone[i] = 1;
+        remaining--;
+        continue;
+      }
+
+      // wait for the bumper to be released before starting again from rest
+      if (states[i].isAnyPressed)
+      {
+        robot.sendSpeed(0, 0);
+        speeds[i] = 0;
+        continue;
+      }
+
+      Vector2 pos = robot.getPos();
+      double  curvature;
+      {
+        TIME_STAGE(ProfileStage::Decide);
+        curvature = trackers[i].getCurvature(pos, robot.getYaw(), speeds[i]);
+
+        // head for the pursuit speed no faster than the base can change speed
+        double target = std::min(velocity, trackers[i].getRemainingDistance(pos) * TEAM_SLOWDOWN_GAIN),
+               change = robot.maxAcceleration * states[i].dt;
+        speeds[i] = std::max(speeds[i] - change, std::min(speeds[i] + change, target));
+
+        if (fabs(speeds[i] * curvature) > angularVelocity) speeds[i] = angularVelocity / fabs(curvature);
+      }
+
+      // no forward arc reaches a point behind the robot, so turn to face it first
+      if (trackers[i].isLookaheadBehind())
+      {
+        speeds[i] = 0;
+        robot.sendSpeed(0, trackers[i].getLookaheadBearing() < 0 ? -angularVelocity : angularVelocity);
+        continue;
+      }
+
+      robot.sendSpeed(speeds[i], speeds[i] * curvature);
+    }
+
+    read();
+  }
+
+  stop();
+}
@@ -0,0 +1,69 @@
+#ifndef ROBOT_TEAM_H
+#define ROBOT_TEAM_H
+#pragma once
+
+#include <libplayerc++/playerc++.h>
+#include <string>
+#include <vector>
+#include "Robot.h"
+#include "ControlLoop.h"
+
+/**
+ * Several robots driven from one process through a single client. Robot i
+ * uses the devices with index i on the server, e.g. position2d:1 and laser:1
+ * for the second robot, so every robot in the world file can share one port.
+ *
+ * One read fetches data for the whole team and snapshots every robot, which
+ * are kept side by side in one array. A robot in a team can still be driven
+ * with any of its own blocking methods, in which case every read it does
+ * updates the rest of the team too, or the whole team can be stepped together
+ * with followPaths().
+ *
+ * Everything happens on the thread that owns the team; robots in a team never
+ * start reader threads of their own.
+ */
+class RobotTeam
+{
+  friend class Robot;
+
+  PlayerCc::PlayerClient  client;  // shared by every robot in the team
+  ControlLoop             loop;    // paces reads for the whole team
+  std::vector<RobotState> states;  // snapshot of every robot, in the same order as robots
+  std::vector<Robot*>     robots;
+
+public:
+  // constructor
+  RobotTeam(int    robotCount,
+            bool   isUsingLaser            = true,
+            double movementScale           = 1.0,
+            double rotationScale           = 1.0,
+            PositionMethod::Enum posMethod = PositionMethod::Fused,
+            double tickInterval            = 0.1,
+            std::string hostname           = "localhost",
+            unsigned port                  = PlayerCc::PLAYER_PORTNUM);
+
+  // owns its robots and the client they talk through, so it is never copied
+  RobotTeam(const RobotTeam&) = delete;
+  RobotTeam& operator=(const RobotTeam&) = delete;
+
+  // destructor
+  ~RobotTeam();
+
+  // robots
+  int getRobotCount() const;
+  Robot& getRobot(int index);
+  const RobotState& getState(int index) const;
+  const ControlLoop& getControlLoop() const;
+
+  // read from the environment for every robot at once
+  void read();
+
+  // move every robot together
+  void stop();
+  void followPaths(const std::vector<std::vector<Vector2> >& paths,
+                   double velocity        = 0.5,
+                   double angularVelocity = 1.0,
+                   double errorRange      = 0.25);
+};
+
+#endif
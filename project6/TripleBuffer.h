@@ -0,0 +1,62 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+#pragma once
+
+#include <atomic>
+
+/**
+ * Hands values from one writer thread to one reader thread without either of
+ * them ever waiting on the other.
+ *
+ * There are three buffers. The writer fills in the back buffer and swaps it
+ * with the middle one when it is done, and the reader swaps the middle buffer
+ * with the front one whenever there is something new in it. Each swap is a
+ * single atomic exchange so neither side can see a half-written value, and
+ * the reader always gets the newest complete value.
+ */
+template <class T>
+class TripleBuffer
+{
+  static const int INDEX_MASK = 3, // bits of middle that hold the index
+                   FRESH_BIT  = 4; // set in middle when it holds a value the reader has not seen
+
+  T buffers[3];
+  std::atomic<int> middle; // index of the middle buffer, plus FRESH_BIT
+  int back,                // index of the buffer owned by the writer
+      front;               // index of the buffer owned by the reader
+
+public:
+  // constructor
+  TripleBuffer() : middle(1), back(0), front(2) {}
+
+  // writer side
+  T&   getBack() { return buffers[back]; }
+  void publish();
+
+  // reader side
+  bool update();
+  const T& getFront() const { return buffers[front]; }
+};
+
+/** Hands the back buffer over to the reader. Only call from the writer thread */
+template <class T>
+void TripleBuffer<T>::publish()
+{
+  back = middle.exchange(back | FRESH_BIT, std::memory_order_acq_rel) & INDEX_MASK;
+}
+
+/**
+ * Takes the newest value published by the writer. Only call from the reader thread
+ *
+ * @return true if there was a new value. False leaves the front buffer unchanged
+ */
+template <class T>
+bool TripleBuffer<T>::update()
+{
+  if (!(middle.load(std::memory_order_relaxed) & FRESH_BIT)) return false;
+
+  front = middle.exchange(front, std::memory_order_acq_rel) & INDEX_MASK;
+  return true;
+}
+
+#endif
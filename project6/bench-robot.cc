@@ -0,0 +1,142 @@
+/**
+ * Proj6
+ * Group10: Aguilar, Andrew, Kamel, Fitzgerald
+ *
+ * Times how much picking the pose source, bumper reaction and laser at
+ * compile time saves per tick. Both sides run the same BasicRobot decisions
+ * on the same snapshot, from the same localized pose and with no pose
+ * prediction. The only difference is how the policies are reached:
+ *
+ *   RuntimeRobot asks Robot for its pose, which branches on posMethod, hands
+ *   the snapshot to its bumper reaction through a virtual call and asks Robot
+ *   whether there is a laser every tick, the way Robot's own loops do.
+ *
+ *   LaserRobot has all three fixed at compile time.
+ *
+ * Reading from the server is left out, as it costs the same either way.
+ */
+#include "Robot.h"
+#include "BasicRobot.h"
+#include <chrono>
+
+const int    TICK_COUNT = 10000000;     // number of ticks to time each robot over
+const double VELOCITY   = 0.5;          // m/s
+const double ANGULAR    = 1.0;          // rad/s
+const double ERROR      = 0.25;         // m
+Vector2      WAYPOINT   = Vector2(6, 4); // somewhere for the robot to head for
+
+/**
+ * Pose policy that asks Robot, which picks the source by posMethod at run time
+ */
+struct RobotPose
+{
+  Robot *robot;
+
+  Vector2 getPos(const RobotState& state) const { return robot->getPos(); }
+  double  getYaw(const RobotState& state) const { return robot->getYaw(); }
+};
+
+/**
+ * Bumper reaction reached through a virtual call, like BumperEventState
+ */
+struct BumperReaction
+{
+  virtual ~BumperReaction() {}
+  virtual bool getCommand(const RobotState& state, double& forwardVelocity, double& angularVelocity) = 0;
+};
+
+/**
+ * BackOffBumpers behind the virtual call
+ */
+struct BackOffReaction : public BumperReaction
+{
+  BackOffBumpers bumpers;
+
+  bool getCommand(const RobotState& state, double& forwardVelocity, double& angularVelocity)
+  {
+    return bumpers.getCommand(state, forwardVelocity, angularVelocity);
+  }
+};
+
+/**
+ * Bumper policy that hands every snapshot to a BumperReaction
+ */
+struct VirtualBumpers
+{
+  BumperReaction *reaction;
+
+  bool getCommand(const RobotState& state, double& forwardVelocity, double& angularVelocity)
+  {
+    return reaction->getCommand(state, forwardVelocity, angularVelocity);
+  }
+};
+
+/**
+ * Laser policy that asks Robot whether it has a laser every tick
+ */
+struct RobotLaser
+{
+  Robot *robot;
+
+  bool   hasLaser() const                          { return robot->getMaxLaserRange() > 0; }
+  double getMinLeft(const RobotState& state) const  { return state.laserMinLeft; }
+  double getMinRight(const RobotState& state) const { return state.laserMinRight; }
+};
+
+// the same decisions with every policy reached at run time
+typedef BasicRobot<RobotPose, VirtualBumpers, RobotLaser> RuntimeRobot;
+
+// Forward declarations
+template <class RobotType>
+double timeDecisions(RobotType& robot);
+
+// results land here so the compiler cannot throw the work away
+volatile double sink;
+
+int main(int argc, char *argv[])
+{
+  // Create robot with lasers enabled, trusting localization like LaserRobot does.
+  // Velocities come from its saved calibration
+  Robot robot(true, 1.0, 1.0, PositionMethod::Localization);
+  robot.read();
+
+  BackOffReaction reaction;
+  RobotPose       pose      = { &robot };
+  VirtualBumpers  bumpers   = { &reaction };
+  RobotLaser      laser     = { &robot };
+  RuntimeRobot    runtimeRobot(robot, bumpers, pose, laser);
+  LaserRobot      laserRobot(robot);
+
+  double runtime  = timeDecisions(runtimeRobot),
+         compiled = timeDecisions(laserRobot);
+
+  std::cout << "RuntimeRobot: " << runtime  << " ns per tick\n" <<
+               "LaserRobot:   " << compiled << " ns per tick\n" <<
+               "Saving:       " << runtime - compiled << " ns per tick (" <<
+               100.0 * (runtime - compiled) / runtime << "%)\n";
+}
+
+/**
+ * Times the decisions a robot makes every tick of moveToWaypoint() and
+ * autoPilotLaser()
+ *
+ * @param robot - the robot being timed
+ * @return time taken per tick in nanoseconds
+ */
+template <class RobotType>
+double timeDecisions(RobotType& robot)
+{
+  double total = 0, forward, angular;
+  auto   start = std::chrono::steady_clock::now();
+
+  for (int i = 0; i < TICK_COUNT; i++)
+  {
+    if (robot.getWaypointCommand(WAYPOINT, VELOCITY, ANGULAR, ERROR, forward, angular)) total += forward + angular;
+    if (robot.getAutoPilotCommand(VELOCITY, ANGULAR, forward, angular))                 total += angular;
+  }
+
+  std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+  sink = total;
+
+  return elapsed.count() / TICK_COUNT;
+}
@@ -0,0 +1,22 @@
+/**
+ * Proj6
+ * Group10: Aguilar, Andrew, Kamel, Fitzgerald
+ *
+ * Measures how fast the robot really moves and turns for a few commands and
+ * saves the scales that make it move as asked. Every program picks the saved
+ * calibration up when it creates the robot. Start the robot somewhere with a
+ * couple of meters of free space in front of and behind it.
+ */
+#include "Robot.h"
+
+int main(int argc, char *argv[])
+{
+  // a robot that has never been calibrated starts out from unscaled commands
+  Robot robot(true);
+
+  if (!robot.calibrate())
+  {
+    std::cout << "Calibration was interrupted. Move the robot somewhere more open and try again\n";
+    return 1;
+  }
+}
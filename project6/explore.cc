@@ -0,0 +1,112 @@
+/**
+ * Proj6
+ * Group10: Aguilar, Andrew, Kamel, Fitzgerald
+ *
+ * Builds the map on its own by repeatedly driving towards the nearest frontier
+ * between known free space and unknown space, filling in the map from the laser
+ * as it goes. The finished map is written in the same format as map.txt.
+ */
+#include "Robot.h"
+#include "FrontierMap.h"
+#include "GridPlanner.h"
+#include <vector>
+
+#define MAP_OUTPUT_FILE_NAME "map-explored.txt" // file that we are writing the map to
+
+const int SIZE = 32; // The number of squares per side of the occupancy grid
+
+// Forward declarations
+void scanIntoMap(Robot& robot, FrontierMap& map);
+void explore(Robot& robot, FrontierMap& map);
+
+int main(int argc, char *argv[])
+{
+  // Create robot with lasers enabled. Velocities come from its saved calibration
+  Robot robot(true);
+
+  // planning between legs takes a while, so keep reading in the background to never act on stale data
+  robot.startReaderThread();
+
+  // start out knowing nothing about the world
+  FrontierMap map(SIZE, SIZE);
+
+  // explore until there are no frontiers left
+  explore(robot, map);
+
+  // print and write the final map
+  map.printMap();
+  map.writeMap(MAP_OUTPUT_FILE_NAME);
+
+  // report how fresh the robot's data was
+  printf("Snapshot latency: %.2f ms mean / %.2f ms max\n",
+         robot.getMeanSnapshotLatency() * 1e3, robot.getMaxSnapshotLatency() * 1e3);
+}
+
+/**
+ * Reads the latest laser scan and adds it to the map
+ *
+ * @param robot - the robot doing the exploring
+ * @param map   - the map being built
+ */
+void scanIntoMap(Robot& robot, FrontierMap& map)
+{
+  std::vector<double> ranges, bearings;
+
+  robot.read();
+  if (!robot.getLaserScan(ranges, bearings)) return;
+
+  map.integrateScan(robot.getPos(), robot.getYaw(), ranges, bearings, robot.getMaxLaserRange());
+  map.updateFrontiers();
+}
+
+/**
+ * Has the robot drive to the nearest frontier one leg at a time, scanning after
+ * every leg, until every reachable frontier has been seen
+ *
+ * @param robot - the robot doing the exploring
+ * @param map   - the map being built
+ */
+void explore(Robot& robot, FrontierMap& map)
+{
+  // Determine how to handle bumper events
+  DynamicWindowRecovery bumperState;
+
+  // unknown cells count as occupied so the robot only plans through space it has seen
+  GridPlanner<FrontierMap> planner(map, HeuristicMethod::Manhattan);
+  std::vector<int> costs;
+
+  while (1)
+  {
+    scanIntoMap(robot, map);
+
+    // find the closest frontier we can actually drive to
+    Vector2 pos = robot.getPos();
+    planner.getWavefrontCosts(map.worldToIndex(pos), costs);
+
+    int frontier = map.getNearestFrontier(costs);
+    if (frontier < 0) break;
+
+    // the laser only sees in front of the robot, so turn around to look behind it
+    if (frontier == map.worldToIndex(pos))
+    {
+      robot.rotateByRadians(M_PI, 1.0);
+      scanIntoMap(robot, map);
+
+      // give up on the frontier if turning around did not reveal anything
+      if (map.isFrontier(frontier)) map.closeFrontier(frontier);
+      continue;
+    }
+
+    std::cout << "\n" << map.getFrontiers().size() << " frontier cells left. " <<
+                 "Heading towards " << map.getCellCenter(frontier) << "\n";
+
+    // only drive the first leg so the new scan can change our mind
+    std::vector<Vector2> waypoints = planner.getWaypoints(pos, map.getCellCenter(frontier));
+    if (waypoints.empty()) break;
+
+    Vector2 wp = map.getCellCenter(map.worldToIndex(waypoints[waypoints.size() > 1 ? 1 : 0]));
+    robot.moveToWaypoint(wp, bumperState, 0.5, 1.0, 0.2);
+  }
+
+  std::cout << "\nNo frontiers left. Exploration finished\n";
+}
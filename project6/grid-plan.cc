@@ -0,0 +1,168 @@
+/**
+ * Proj6
+ * Group10: Aguilar, Andrew, Kamel, Fitzgerald
+ *
+ * C++ version of MapPlanner.java. Plans a path over map.txt and writes the
+ * waypoints to plan-out.txt for make-plan to follow. The written plan comes from
+ * the lattice planner so it accounts for how long the robot takes to rotate.
+ */
+#include "GridPlanner.h"
+#include "LatticePlanner.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib> // atoi
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#define MAP_INPUT_FILE_NAME   "map.txt"      // file that we are reading the map from
+#define PLAN_OUTPUT_FILE_NAME "plan-out.txt" // file that we are writing the plan to
+#define MOTION_COSTS_FILE_NAME "motion-costs.txt" // motion costs measured by time-motion
+
+const int SIZE = 32; // The number of squares per side of the occupancy grid
+
+// Forward declarations
+template <class GridType>
+int planOverMap(GridType& grid, const char* mapFileName);
+double getPlanTime(std::vector<Vector2>& plan, double startYaw, MotionCosts& costs, double cellSize);
+void printPlan(std::vector<Vector2>& plan);
+void writePlan(std::vector<Vector2>& plan);
+
+int main(int argc, char *argv[])
+{
+  // optionally take a different map and its side length: grid-plan [map file] [side length]
+  const char *mapFileName = argc > 1 ? argv[1] : MAP_INPUT_FILE_NAME;
+  int sideLength          = argc > 2 ? atoi(argv[2]) : SIZE;
+
+  // the usual 32x32 map has all of its index math resolved at compile time
+  if (sideLength == SIZE)
+  {
+    Grid<SIZE, SIZE> grid;
+    return planOverMap(grid, mapFileName);
+  }
+
+  // fall back to a grid sized at runtime for anything else
+  DynamicGrid grid(sideLength, sideLength);
+  return planOverMap(grid, mapFileName);
+}
+
+/**
+ * Reads in the map, plans a path from the start to the goal, then prints
+ * and writes the final plan.
+ *
+ * @param grid        - empty grid to read the map into
+ * @param mapFileName - name of the file to read the map from
+ * @return exit code for the program
+ */
+template <class GridType>
+int planOverMap(GridType& grid, const char* mapFileName)
+{
+  // read in the map and dilate it to account for the robot's size
+  if (!grid.readMap(mapFileName))
+  {
+    std::cout << "Failed to read " << mapFileName << ". Exiting\n";
+    return 1;
+  }
+  grid.dilate();
+  grid.printMap();
+
+  // create points for the locations we are moving to. The robot starts facing -45 degrees
+  Vector2 start(-6.0, -6.0),
+          goal ( 6.5,  6.5);
+  double startYaw = -M_PI / 4.0;
+
+  // compare the plain Manhattan heuristic against the landmark one
+  GridPlanner<GridType> manhattan(grid, HeuristicMethod::Manhattan),
+                        planner  (grid, HeuristicMethod::Landmarks);
+
+  manhattan.getWaypoints(start, goal);
+  std::vector<Vector2> shortest = planner.getWaypoints(start, goal);
+  if (shortest.empty()) return 1;
+
+  std::cout << "\nCells expanded with Manhattan: " << manhattan.getExpandedCount() << "\n" <<
+               "Cells expanded with landmarks: " << planner.getExpandedCount()   << "\n";
+
+  // use measured motion costs when time-motion has been run
+  MotionCosts costs;
+  if (!costs.readCosts(MOTION_COSTS_FILE_NAME))
+  {
+    std::cout << "No " << MOTION_COSTS_FILE_NAME << " found. Using default motion costs\n";
+  }
+
+  // find the path that is fastest to drive rather than the shortest one
+  LatticePlanner<GridType> lattice(grid, costs);
+  std::vector<Vector2> plan = lattice.getWaypoints(start, startYaw, goal);
+  if (plan.empty()) return 1;
+
+  printf("Shortest path takes about %.1f s, fastest path takes about %.1f s\n",
+         getPlanTime(shortest, startYaw, costs, grid.getCellSize()),
+         getPlanTime(plan,     startYaw, costs, grid.getCellSize()));
+
+  // print and write the final plan
+  printPlan(plan);
+  writePlan(plan);
+
+  return 0;
+}
+
+/**
+ * Estimates how long the robot takes to drive a plan, turning in place at every
+ * waypoint the same way moveToWaypoint() does.
+ *
+ * @param plan     - the waypoints to drive
+ * @param startYaw - yaw rotation of the robot at the start in radians
+ * @param costs    - how long each motion takes
+ * @param cellSize - length of one side of a cell in meters
+ * @return estimated time in seconds
+ */
+double getPlanTime(std::vector<Vector2>& plan, double startYaw, MotionCosts& costs, double cellSize)
+{
+  double time = 0, yaw = startYaw;
+
+  for (int i = 0; i + 1 < plan.size(); i++)
+  {
+    Vector2 leg = plan[i + 1] - plan[i];
+    double legYaw = atan2(leg.y, leg.x);
+
+    // turn towards the next waypoint in quarter turns
+    int quarters = (int)floor(fabs(remainder(legYaw - yaw, 2.0 * M_PI)) / (M_PI / 2.0) + 0.5);
+    if      (quarters == 1) time += costs.quarterTurnTime;
+    else if (quarters == 2) time += costs.halfTurnTime;
+
+    time += Vector2::getMagnitude(leg) / cellSize * costs.cellTime;
+    yaw   = legYaw;
+  }
+
+  return time;
+}
+
+/**
+ * Print the plan on the screen, one waypoint to a line, x then y
+ * with a header to remind us which is which.
+ */
+void printPlan(std::vector<Vector2>& plan)
+{
+  std::cout << "\n    x     y\n";
+  for (int i = 0; i < plan.size(); i++)
+  {
+    printf("%5.1f %5.1f\n", plan[i].x, plan[i].y);
+  }
+}
+
+/**
+ * Send the plan to the file PLAN_OUTPUT_FILE_NAME, preceeded by
+ * the information about how long it is.
+ */
+void writePlan(std::vector<Vector2>& plan)
+{
+  std::ofstream planFile;
+  planFile.open(PLAN_OUTPUT_FILE_NAME);
+
+  planFile << plan.size() * 2 << " ";
+  for (int i = 0; i < plan.size(); i++)
+  {
+    planFile << plan[i].x << " " << plan[i].y << " ";
+  }
+
+  planFile.close();
+}
@@ -0,0 +1,39 @@
+/**
+ * Proj6
+ * Group10: Aguilar, Andrew, Kamel, Fitzgerald
+ *
+ * Localizes the robot by choosing the motions that should tell its hypotheses
+ * apart the fastest, then reports how long it took. Run with "circle" to time
+ * the old drive-backwards-in-a-circle localization instead.
+ */
+#include "ActiveLocalizer.h"
+#include "Grid.h"
+#include "Robot.h"
+#include <cstdio>
+#include <cstring> // strcmp
+
+#define MAP_INPUT_FILE_NAME "map.txt" // file that we are reading the map from
+
+const int SIZE = 32; // The number of squares per side of the occupancy grid
+
+int main(int argc, char *argv[])
+{
+  // Create robot with lasers enabled. Velocities come from its saved calibration
+  Robot robot(true);
+
+  if (argc > 1 && strcmp(argv[1], "circle") == 0)
+  {
+    robot.localize();
+    return 0;
+  }
+
+  Grid<SIZE, SIZE> grid;
+  if (!grid.readMap(MAP_INPUT_FILE_NAME))
+  {
+    printf("Could not read %s\n", MAP_INPUT_FILE_NAME);
+    return 1;
+  }
+
+  ActiveLocalizer< Grid<SIZE, SIZE> > localizer(grid);
+  return localizer.localize(robot) ? 0 : 1;
+}
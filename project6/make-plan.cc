@@ -24,8 +24,8 @@ std::vector<Vector2> getWaypoints();
 
 int main(int argc, char *argv[])
 {  
-  // Create robot with lasers enabled and movement+rotation scaled up by 1.35
-  Robot robot(true, 1.35, 1.35);
+  // Create robot with lasers enabled. Velocities come from its saved calibration
+  Robot robot(true);
 
   // Generate waypoints needed to follow the given plan
   std::vector<Vector2> waypoints = getWaypoints();
@@ -182,19 +182,18 @@ std::vector<Vector2> getWaypoints()
 void followPlan(std::vector<Vector2>& waypoints, Robot& robot)
 {
   // Determine how to handle bumper events
-  AutoPilot bumperState;
+  DynamicWindowRecovery bumperState;
 
-  // Follow the plan
-  for (int i = 0; i < waypoints.size(); ++i)
-  {
-    // print where we are heading to
-    std::cout << "\nNow moving to coordinate: " << waypoints[i] << "\n";
+  if (waypoints.empty()) return;
 
-    // move to given location
-    robot.moveToWaypoint(waypoints[i], bumperState, 3.0, 1.0, 0.2);
+  // Follow the whole plan in one continuous motion rather than stopping at every waypoint
+  std::cout << "\nNow following " << waypoints.size() << " waypoints to: " << waypoints.back() << "\n";
+  robot.followPath(waypoints, bumperState, 3.0, 1.0, 0.2);
 
-    // report the robot's actual final location
-    std::cout << "Now at the following position:\n";
-    robot.printLocalizedPosition();
-  }
+  // report the robot's actual final location
+  std::cout << "Now at the following position:\n";
+  robot.printLocalizedPosition();
+
+  // report how well the robot kept to its tick rate
+  robot.getControlLoop().printStats();
 }
@@ -0,0 +1,175 @@
+/**
+ * Proj6
+ * Group10: Aguilar, Andrew, Kamel, Fitzgerald
+ *
+ * Visits every goal in plan.txt in the shortest order it can find, planning
+ * each leg of the mission while the robot is still driving the one before.
+ * The robot drives on a MotionExecutor's thread, so the main thread is free to
+ * run the planner and queue up the next leg before the current one ends, and
+ * the robot carries straight on from one leg into the next.
+ */
+#include "GridPlanner.h"
+#include "MissionPlanner.h"
+#include "MotionExecutor.h"
+#include "Robot.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#define MAP_INPUT_FILE_NAME  "map.txt"  // file that we are reading the map from
+#define PLAN_INPUT_FILE_NAME "plan.txt" // file that we are reading the goals from
+
+const int SIZE = 32; // The number of squares per side of the occupancy grid
+
+// Forward declarations
+std::vector<Vector2> readGoals();
+std::vector<Vector2> planLeg(GridPlanner<Grid<SIZE, SIZE> >& planner, Vector2 from, Vector2 to);
+
+int main(int argc, char *argv[])
+{
+  // read in the map and dilate it to account for the robot's size
+  Grid<SIZE, SIZE> grid;
+  if (!grid.readMap(MAP_INPUT_FILE_NAME))
+  {
+    std::cout << "Failed to read " << MAP_INPUT_FILE_NAME << ". Exiting\n";
+    return 1;
+  }
+  grid.dilate();
+
+  // Create robot with lasers enabled. Velocities come from its saved calibration
+  Robot robot(true);
+  robot.read();
+
+  // the robot's starting location is the first node, followed by every reachable goal
+  Vector2 start = robot.getPos();
+  std::vector<Vector2> goals = readGoals(),
+                       nodes(1, start);
+  std::vector<int>     cells(1, grid.worldToIndex(start));
+
+  if (cells[0] < 0)
+  {
+    std::cout << "The robot is off the map at " << start << ". Exiting\n";
+    return 1;
+  }
+
+  for (int i = 0; i < goals.size(); i++)
+  {
+    int cell = grid.worldToIndex(goals[i]);
+    if (cell < 0 || grid.isOccupied(cell))
+    {
+      std::cout << "Skipping unreachable goal " << goals[i] << "\n";
+      continue;
+    }
+
+    nodes.push_back(goals[i]);
+    cells.push_back(cell);
+  }
+
+  std::vector<int> costs = getPathCosts(grid, cells);
+  for (int i = 1; i < cells.size(); i++)
+  {
+    if (costs[i] == INT_MAX)
+    {
+      std::cout << "No path from the start to " << nodes[i] << ". Exiting\n";
+      return 1;
+    }
+  }
+
+  MissionPlanner   mission(costs, nodes.size());
+  std::vector<int> order = mission.getVisitOrder();
+  if (order.size() < 2) return 0;
+
+  GridPlanner<Grid<SIZE, SIZE> > planner(grid);
+  DynamicWindowRecovery          bumperState;
+
+  // from here on the executor owns the robot
+  MotionExecutor executor(robot);
+
+  // only the first leg is planned before setting off
+  MotionHandle driving = executor.followPath(planLeg(planner, nodes[order[0]], nodes[order[1]]),
+                                             bumperState, 3.0, 1.0, 0.2);
+  for (int i = 1; i + 1 < order.size(); i++)
+  {
+    // plan the next leg while the robot drives this one, then queue it up behind it
+    std::chrono::steady_clock::time_point planStart = std::chrono::steady_clock::now();
+    std::vector<Vector2> leg = planLeg(planner, nodes[order[i]], nodes[order[i + 1]]);
+    double planMs = std::chrono::duration<double>(std::chrono::steady_clock::now() - planStart).count() * 1e3;
+
+    printf("Planned leg %d in %.2f ms while the robot drives leg %d (%s)\n",
+           i + 1, planMs, i, driving.isDone() ? "already done" : "still driving");
+
+    MotionHandle next = executor.followPath(leg, bumperState, 3.0, 1.0, 0.2);
+
+    if (!driving.wait())
+    {
+      std::cout << "Leg " << i << " did not reach " << nodes[order[i]] << ". Stopping the mission\n";
+      executor.cancelAll();
+      return 1;
+    }
+    std::cout << "Reached " << nodes[order[i]] << "\n";
+
+    driving = next;
+  }
+
+  bool isDone = driving.wait();
+  std::cout << (isDone ? "Reached " : "Did not reach ") << nodes[order.back()] << "\n";
+
+  // report the robot's actual final location
+  RobotState state = executor.getState();
+  std::cout << "Now at " << state.fusedPos << "\n";
+
+  return isDone ? 0 : 1;
+}
+
+/**
+ * Plans a single leg of the mission
+ *
+ * @param planner - planner over the dilated map
+ * @param from    - where the leg starts
+ * @param to      - where the leg ends
+ * @return waypoints for followPath(), without the start as the robot is already there
+ */
+std::vector<Vector2> planLeg(GridPlanner<Grid<SIZE, SIZE> >& planner, Vector2 from, Vector2 to)
+{
+  std::vector<Vector2> leg = planner.getWaypoints(from, to);
+  if (!leg.empty()) leg.erase(leg.begin());
+
+  return leg;
+}
+
+/**
+ * Reads in the goals from PLAN_INPUT_FILE_NAME. The file starts with the number
+ * of coordinates followed by the x and y of each goal.
+ *
+ * @return the goals in the order they appear in the file
+ */
+std::vector<Vector2> readGoals()
+{
+  std::vector<Vector2> goals;
+  int length;
+  double x, y;
+
+  std::ifstream planFile;
+  planFile.open(PLAN_INPUT_FILE_NAME);
+
+  planFile >> length;
+
+  // Some minimal error checking
+  if((length % 2) != 0)
+  {
+    std::cout << "The plan has mismatched x and y coordinates" << std::endl;
+    exit(1);
+  }
+
+  for (int i = 0; i < length; i += 2)
+  {
+    planFile >> x >> y;
+    goals.push_back(Vector2(x, y));
+  }
+
+  planFile.close();
+
+  return goals;
+}
@@ -0,0 +1,161 @@
+/**
+ * Proj6
+ * Group10: Aguilar, Andrew, Kamel, Fitzgerald
+ *
+ * Reorders the goals in plan.txt so the robot visits them along the shortest
+ * route it can find, then writes the waypoints for every leg to plan-out.txt
+ * for make-plan to follow.
+ */
+#include "MissionPlanner.h"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#define MAP_INPUT_FILE_NAME   "map.txt"      // file that we are reading the map from
+#define PLAN_INPUT_FILE_NAME  "plan.txt"     // file that we are reading the goals from
+#define PLAN_OUTPUT_FILE_NAME "plan-out.txt" // file that we are writing the plan to
+
+const int SIZE = 32; // The number of squares per side of the occupancy grid
+
+// Forward declarations
+std::vector<Vector2> readGoals();
+void printGoals(const char* header, std::vector<Vector2>& goals, std::vector<int>& order);
+void writePlan(std::vector<Vector2>& plan);
+
+int main(int argc, char *argv[])
+{
+  // read in the map and dilate it to account for the robot's size
+  Grid<SIZE, SIZE> grid;
+  if (!grid.readMap(MAP_INPUT_FILE_NAME))
+  {
+    std::cout << "Failed to read " << MAP_INPUT_FILE_NAME << ". Exiting\n";
+    return 1;
+  }
+  grid.dilate();
+
+  // the robot's starting location is the first node, followed by every reachable goal
+  Vector2 start(-6.0, -6.0);
+  std::vector<Vector2> goals = readGoals(),
+                       nodes(1, start);
+  std::vector<int>     cells(1, grid.worldToIndex(start));
+
+  if (cells[0] < 0)
+  {
+    std::cout << "The start " << start << " is off the map. Exiting\n";
+    return 1;
+  }
+
+  for (int i = 0; i < goals.size(); i++)
+  {
+    int cell = grid.worldToIndex(goals[i]);
+    if (cell < 0 || grid.isOccupied(cell))
+    {
+      std::cout << "Skipping unreachable goal " << goals[i] << "\n";
+      continue;
+    }
+
+    nodes.push_back(goals[i]);
+    cells.push_back(cell);
+  }
+
+  // find the cost of travelling between every pair of nodes
+  std::vector<int> costs = getPathCosts(grid, cells);
+  for (int i = 1; i < cells.size(); i++)
+  {
+    if (costs[i] == INT_MAX)
+    {
+      std::cout << "No path from the start to " << nodes[i] << ". Exiting\n";
+      return 1;
+    }
+  }
+
+  // compare the order from the file against the optimized one
+  MissionPlanner mission(costs, nodes.size());
+  std::vector<int> fileOrder, order = mission.getVisitOrder();
+  for (int i = 0; i < nodes.size(); i++) fileOrder.push_back(i);
+
+  printGoals("Goals in file order",      nodes, fileOrder);
+  std::cout << "Total cost: " << mission.getTourCost(fileOrder) << " cells\n";
+  printGoals("Goals in optimized order", nodes, order);
+  std::cout << "Total cost: " << mission.getTourCost(order)     << " cells\n";
+
+  // plan each leg of the mission and join them into a single plan
+  GridPlanner<Grid<SIZE, SIZE> > planner(grid);
+  std::vector<Vector2> plan(1, start);
+  for (int i = 0; i + 1 < order.size(); i++)
+  {
+    std::vector<Vector2> leg = planner.getWaypoints(nodes[order[i]], nodes[order[i + 1]]);
+
+    // the first waypoint of each leg is where the last one ended
+    if (!leg.empty()) plan.insert(plan.end(), leg.begin() + 1, leg.end());
+  }
+
+  writePlan(plan);
+}
+
+/**
+ * Reads in the goals from PLAN_INPUT_FILE_NAME. The file starts with the number
+ * of coordinates followed by the x and y of each goal.
+ *
+ * @return the goals in the order they appear in the file
+ */
+std::vector<Vector2> readGoals()
+{
+  std::vector<Vector2> goals;
+  int length;
+  double x, y;
+
+  std::ifstream planFile;
+  planFile.open(PLAN_INPUT_FILE_NAME);
+
+  planFile >> length;
+
+  // Some minimal error checking
+  if((length % 2) != 0)
+  {
+    std::cout << "The plan has mismatched x and y coordinates" << std::endl;
+    exit(1);
+  }
+
+  for (int i = 0; i < length; i += 2)
+  {
+    planFile >> x >> y;
+    goals.push_back(Vector2(x, y));
+  }
+
+  planFile.close();
+
+  return goals;
+}
+
+/**
+ * Print the goals on the screen in the given order, one to a line, x then y
+ * with a header to remind us which is which.
+ */
+void printGoals(const char* header, std::vector<Vector2>& goals, std::vector<int>& order)
+{
+  std::cout << "\n" << header << "\n    x     y\n";
+  for (int i = 0; i < order.size(); i++)
+  {
+    printf("%5.1f %5.1f\n", goals[order[i]].x, goals[order[i]].y);
+  }
+}
+
+/**
+ * Send the plan to the file PLAN_OUTPUT_FILE_NAME, preceeded by
+ * the information about how long it is.
+ */
+void writePlan(std::vector<Vector2>& plan)
+{
+  std::ofstream planFile;
+  planFile.open(PLAN_OUTPUT_FILE_NAME);
+
+  planFile << plan.size() * 2 << " ";
+  for (int i = 0; i < plan.size(); i++)
+  {
+    planFile << plan[i].x << " " << plan[i].y << " ";
+  }
+
+  planFile.close();
+}
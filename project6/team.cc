@@ -0,0 +1,117 @@
+/**
+ * Proj6
+ * Group10: Aguilar, Andrew, Kamel, Fitzgerald
+ *
+ * Drives several robots at once through a single client. Robot i heads for
+ * goal i in plan.txt along a path planned over map.txt, and every robot
+ * follows its path at the same time. The world file needs a robot for each
+ * device index from 0 up, e.g. position2d:0 and position2d:1 for two robots.
+ *
+ * Usage: team [robot count]
+ */
+#include "GridPlanner.h"
+#include "RobotTeam.h"
+#include <cstdio>
+#include <cstdlib> // atoi
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#define MAP_INPUT_FILE_NAME  "map.txt"  // file that we are reading the map from
+#define PLAN_INPUT_FILE_NAME "plan.txt" // file that we are reading the goals from
+
+const int SIZE = 32; // The number of squares per side of the occupancy grid
+
+// Forward declarations
+std::vector<Vector2> readGoals();
+
+int main(int argc, char *argv[])
+{
+  int robotCount = argc > 1 ? atoi(argv[1]) : 2;
+  if (robotCount < 1)
+  {
+    std::cout << "Usage: team [robot count]\n";
+    return 1;
+  }
+
+  // read in the map and dilate it to account for the robots' size
+  Grid<SIZE, SIZE> grid;
+  if (!grid.readMap(MAP_INPUT_FILE_NAME))
+  {
+    std::cout << "Failed to read " << MAP_INPUT_FILE_NAME << ". Exiting\n";
+    return 1;
+  }
+  grid.dilate();
+
+  std::vector<Vector2> goals = readGoals();
+  if ((int)goals.size() < robotCount)
+  {
+    std::cout << "Need a goal in " << PLAN_INPUT_FILE_NAME << " for each of the " << robotCount << " robots\n";
+    return 1;
+  }
+
+  // Create the team with lasers enabled. Velocities come from each robot's saved calibration
+  RobotTeam team(robotCount);
+
+  // plan a path for every robot from wherever it is now
+  GridPlanner<Grid<SIZE, SIZE> > planner(grid);
+  std::vector<std::vector<Vector2> > paths;
+  for (int i = 0; i < robotCount; i++)
+  {
+    Vector2 start = team.getRobot(i).getPos();
+    std::vector<Vector2> path = planner.getWaypoints(start, goals[i]);
+
+    // the robot is already at the first waypoint
+    if (!path.empty()) path.erase(path.begin());
+    else std::cout << "Robot " << i << " has no path from " << start << " to " << goals[i] << ", it stays put\n";
+
+    std::cout << "Robot " << i << " heading to " << goals[i] << " through " << path.size() << " waypoints\n";
+    paths.push_back(path);
+  }
+
+  team.followPaths(paths, 1.0, 1.0, 0.2);
+
+  // report where every robot ended up
+  for (int i = 0; i < robotCount; i++)
+  {
+    std::cout << "Robot " << i << " now at " << team.getRobot(i).getPos() << "\n";
+  }
+
+  // report how well the team kept to its tick rate
+  team.getControlLoop().printStats();
+}
+
+/**
+ * Reads in the goals from PLAN_INPUT_FILE_NAME. The file starts with the number
+ * of coordinates followed by the x and y of each goal.
+ *
+ * @return the goals in the order they appear in the file
+ */
+std::vector<Vector2> readGoals()
+{
+  std::vector<Vector2> goals;
+  int length;
+  double x, y;
+
+  std::ifstream planFile;
+  planFile.open(PLAN_INPUT_FILE_NAME);
+
+  planFile >> length;
+
+  // Some minimal error checking
+  if((length % 2) != 0)
+  {
+    std::cout << "The plan has mismatched x and y coordinates" << std::endl;
+    exit(1);
+  }
+
+  for (int i = 0; i < length; i += 2)
+  {
+    planFile >> x >> y;
+    goals.push_back(Vector2(x, y));
+  }
+
+  planFile.close();
+
+  return goals;
+}
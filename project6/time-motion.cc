@@ -0,0 +1,95 @@
+/**
+ * Proj6
+ * Group10: Aguilar, Andrew, Kamel, Fitzgerald
+ *
+ * Measures how long the robot really takes to drive a cell and to turn in
+ * place, then writes the times to motion-costs.txt for the lattice planner.
+ * Start the robot somewhere with a few meters of free space in front of it.
+ */
+#include "Robot.h"
+#include "LatticePlanner.h"
+#include <chrono>
+
+#define MOTION_COSTS_FILE_NAME "motion-costs.txt" // file that we are writing the costs to
+
+const double CELL_SIZE   = 0.5; // length of one side of a cell in the occupancy grid
+const int    CELL_COUNT  = 4;   // number of cells to drive when timing forward motion
+const int    TRIAL_COUNT = 3;   // number of times to repeat each measurement
+
+// Forward declarations
+double timeRotation(Robot& robot, double radians);
+double timeForward(Robot& robot, double meters, BumperEventState& bumperState);
+
+int main(int argc, char *argv[])
+{
+  // Create robot with lasers enabled. Velocities come from its saved calibration
+  Robot robot(true);
+  AutoPilot bumperState;
+
+  double cell = 0, quarter = 0, half = 0;
+
+  for (int i = 0; i < TRIAL_COUNT; i++)
+  {
+    // drive out and back so the robot stays in the same free space
+    cell    += timeForward(robot, CELL_COUNT * CELL_SIZE, bumperState) / CELL_COUNT;
+    half    += timeRotation(robot, M_PI);
+    cell    += timeForward(robot, CELL_COUNT * CELL_SIZE, bumperState) / CELL_COUNT;
+    quarter += timeRotation(robot,  M_PI / 2.0);
+    quarter += timeRotation(robot, -M_PI / 2.0);
+    half    += timeRotation(robot, M_PI);
+  }
+
+  MotionCosts costs(cell / (2 * TRIAL_COUNT), quarter / (2 * TRIAL_COUNT), half / (2 * TRIAL_COUNT));
+
+  std::cout << "Seconds per cell:         " << costs.cellTime        << "\n" <<
+               "Seconds per quarter turn: " << costs.quarterTurnTime << "\n" <<
+               "Seconds per half turn:    " << costs.halfTurnTime    << "\n";
+
+  costs.writeCosts(MOTION_COSTS_FILE_NAME);
+}
+
+/**
+ * Times how long the robot takes to turn in place by the given angle with
+ * rotateToFaceWaypoint(), the same way it turns when following a plan
+ *
+ * @param robot   - the robot being timed
+ * @param radians - angle to turn by. Positive values turn counter-clockwise
+ * @return time taken in seconds
+ */
+double timeRotation(Robot& robot, double radians)
+{
+  robot.read();
+  Vector2 pos = robot.getPos();
+  double  yaw = robot.getYaw() + radians;
+
+  // face a point a meter away in the new direction
+  Vector2 wp(pos.x + cos(yaw), pos.y + sin(yaw));
+
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+  robot.rotateToFaceWaypoint(wp, 1.0);
+
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}
+
+/**
+ * Times how long the robot takes to drive forward by the given distance with
+ * moveToWaypoint(), the same way it drives when following a plan
+ *
+ * @param robot       - the robot being timed
+ * @param meters      - distance to drive forward
+ * @param bumperState - how the robot should respond to bumpers being pressed
+ * @return time taken in seconds
+ */
+double timeForward(Robot& robot, double meters, BumperEventState& bumperState)
+{
+  robot.read();
+  Vector2 pos = robot.getPos();
+  double  yaw = robot.getYaw();
+
+  Vector2 wp(pos.x + meters * cos(yaw), pos.y + meters * sin(yaw));
+
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+  robot.moveToWaypoint(wp, bumperState, 3.0, 1.0, 0.2);
+
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+}